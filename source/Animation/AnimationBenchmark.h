@@ -0,0 +1,76 @@
+//
+//  AnimationBenchmark.h
+//  Tilemap
+//
+//  Compares the per-entity Animate action path with SpriteAnimator on a
+//  large number of looping props. Compiled in only when
+//  ANIMATION_BENCHMARK is defined; it then runs with 500 props at the end
+//  of GamePlayController::init, and the results go to the log.
+//
+
+#ifndef __ANIMATION_BENCHMARK_H__
+#define __ANIMATION_BENCHMARK_H__
+
+// #define ANIMATION_BENCHMARK
+
+#ifdef ANIMATION_BENCHMARK
+
+#include <cugl/cugl.h>
+#include <chrono>
+#include "SpriteAnimator.h"
+
+/**
+ * Animates `props` sprites for `frames` frames of 1/60s both ways and logs
+ * the average cost of one frame.
+ *
+ * @param sheet     A 2x4 sprite sheet, e.g. an item animation
+ * @param props     The number of animated sprites
+ * @param frames    The number of frames to simulate
+ */
+inline void runAnimationBenchmark(const std::shared_ptr<cugl::Texture>& sheet, int props = 500, int frames = 600) {
+    const float dt = 1.0f / 60.0f;
+    const AnimationClip* clip = AnimationClipSet::item().get(0, 0).get();
+
+    std::vector<std::shared_ptr<cugl::scene2::SpriteNode>> nodes;
+    std::vector<std::string> keys;
+    for (int i = 0; i < props; i++) {
+        nodes.push_back(cugl::scene2::SpriteNode::allocWithSheet(sheet, 2, 4, 8));
+        keys.push_back("bench" + std::to_string(i));
+    }
+
+    // one Animate action per prop, restarted when it runs out, as the
+    // views used to do it; the action itself is shared like a clip
+    std::shared_ptr<cugl::scene2::Animate> animate = cugl::scene2::Animate::alloc(clip->getFrames(), clip->getDuration());
+    auto actions = cugl::scene2::ActionManager::alloc();
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        for (int i = 0; i < props; i++) {
+            if (!actions->isActive(keys[i])) {
+                actions->activate(keys[i], animate, nodes[i]);
+            }
+        }
+        actions->update(dt);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double actionTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    // one track per prop in the central ticker
+    SpriteAnimator animator;
+    for (int i = 0; i < props; i++) {
+        animator.play(animator.add(nodes[i]), clip);
+    }
+    start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        animator.update(dt);
+    }
+    end = std::chrono::steady_clock::now();
+    double animatorTime = std::chrono::duration<double, std::milli>(end - start).count();
+
+    CULog("animation benchmark, %d props over %d frames", props, frames);
+    CULog("  ActionManager:  %.4f ms per frame", actionTime / frames);
+    CULog("  SpriteAnimator: %.4f ms per frame", animatorTime / frames);
+}
+
+#endif /* ANIMATION_BENCHMARK */
+
+#endif /* __ANIMATION_BENCHMARK_H__ */
@@ -0,0 +1,131 @@
+//
+//  AnimationClip.h
+//  Tilemap
+//
+//  Sprite animation clips built once per sprite sheet layout and shared by
+//  every view that uses the sheet, so switching direction or state never
+//  allocates.
+//
+
+#ifndef __ANIMATION_CLIP_H__
+#define __ANIMATION_CLIP_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+/** Guard sheet rows, in the order they appear in the 16x16 sheet */
+#define GUARD_CLIP_WALK     0
+#define GUARD_CLIP_RUN      1
+#define GUARD_CLIP_LOOK     2
+#define GUARD_CLIP_IDLE     3
+/** Number of facing directions in the guard and character sheets */
+#define CLIP_DIRECTIONS     8
+/** Frames in one looping clip */
+#define CLIP_FRAMES         8
+
+/**
+ * One looping animation: the frame order and how long a loop takes.
+ * Immutable once built and shared by every view playing it.
+ */
+class AnimationClip {
+private:
+    std::vector<int> _frames;
+    float _duration;
+
+public:
+    AnimationClip(const std::vector<int>& frames, float duration) {
+        _frames = frames;
+        _duration = duration;
+    }
+
+    const std::vector<int>& getFrames() const {
+        return _frames;
+    }
+
+    float getDuration() const {
+        return _duration;
+    }
+
+    /** Returns the frame shown `time` seconds into the loop */
+    int frameAt(float time) const {
+        if (_frames.empty() || _duration <= 0) {
+            return 0;
+        }
+        float loop = std::fmod(time, _duration);
+        int index = (int)(loop / _duration * _frames.size());
+        return _frames[std::min(index, (int)_frames.size() - 1)];
+    }
+};
+
+/**
+ * The clips of one sprite sheet layout, indexed by state and direction.
+ *
+ * Each layout is built the first time it is asked for.
+ */
+class AnimationClipSet {
+private:
+    /** Clips stored row-major: state * directions + direction */
+    std::vector<std::shared_ptr<AnimationClip>> _clips;
+    int _directions;
+
+    /**
+     * Adds one looping clip per direction for a sheet row. Frame
+     * `start + 8 * d` is the rest pose and is played last, as the sheets
+     * are drawn that way.
+     */
+    void addRow(int start, float duration) {
+        for (int d = 0; d < _directions; d++) {
+            std::vector<int> frames;
+            for (int i = 1; i < CLIP_FRAMES; i++) {
+                frames.push_back(start + CLIP_FRAMES * d + i);
+            }
+            frames.push_back(start + CLIP_FRAMES * d);
+            _clips.push_back(std::make_shared<AnimationClip>(frames, duration));
+        }
+    }
+
+public:
+    AnimationClipSet(int directions) : _directions(directions) {}
+
+    /** Returns the clip for a state row and facing direction */
+    const std::shared_ptr<AnimationClip>& get(int state, int direction) const {
+        return _clips[state * _directions + direction];
+    }
+
+    /** The 16x16 guard sheet: walk, run, look around and idle rows */
+    static const AnimationClipSet& guard() {
+        static AnimationClipSet clips = [] {
+            AnimationClipSet set(CLIP_DIRECTIONS);
+            set.addRow(0, 1.0f);
+            set.addRow(64, 0.5f);
+            set.addRow(128, 1.0f);
+            set.addRow(192, 1.0f);
+            return set;
+        }();
+        return clips;
+    }
+
+    /** The 8x8 character sheet: one walk row */
+    static const AnimationClipSet& character() {
+        static AnimationClipSet clips = [] {
+            AnimationClipSet set(CLIP_DIRECTIONS);
+            set.addRow(0, 0.8f);
+            return set;
+        }();
+        return clips;
+    }
+
+    /** The 2x4 artifact and resource sheet: a single loop */
+    static const AnimationClipSet& item() {
+        static AnimationClipSet clips = [] {
+            AnimationClipSet set(1);
+            set.addRow(0, 1.0f);
+            return set;
+        }();
+        return clips;
+    }
+};
+
+#endif /* __ANIMATION_CLIP_H__ */
@@ -0,0 +1,209 @@
+//
+//  SpriteAnimator.h
+//  Tilemap
+//
+//  One ticker for every looping sprite animation in the game. Tracks live in
+//  a contiguous array and are advanced in a single pass per frame, instead of
+//  one string-keyed Animate action per guard, character and item.
+//
+
+#ifndef __SPRITE_ANIMATOR_H__
+#define __SPRITE_ANIMATOR_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <cmath>
+#include "AnimationClip.h"
+
+/** How far outside the camera rect a sprite still animates, in points */
+#define ANIM_CULL_MARGIN    128.0f
+
+class SpriteAnimator {
+private:
+    /** One animated sprite */
+    struct Track {
+        /** The sprite, owned by its view; the view removes the track first */
+        cugl::scene2::SpriteNode* node;
+        /** The node whose position places the sprite in the world */
+        cugl::scene2::SceneNode* anchor;
+        /** The clip playing, shared through AnimationClipSet */
+        const AnimationClip* clip;
+        /** Seconds into the current loop */
+        float time;
+        /** Playback rate, 1 is the clip's own speed */
+        float speed;
+        bool playing;
+        bool live;
+    };
+
+    std::vector<Track> _tracks;
+    /** Indices of removed tracks, reused by `add` */
+    std::vector<int> _free;
+    /** Sprites whose frame was set in the last update */
+    int _advanced;
+    /** Playing sprites skipped in the last update because they are hidden */
+    int _skipped;
+    /** Part of the world worth animating, already grown by the margin */
+    cugl::Rect _view;
+    /** Whether `_view` is set; without it everything visible animates */
+    bool _culling;
+    /** Times either array had to grow its storage */
+    int _allocations;
+
+public:
+    SpriteAnimator() : _advanced(0), _skipped(0), _culling(false), _allocations(0) {}
+
+    static std::shared_ptr<SpriteAnimator> alloc() {
+        return std::make_shared<SpriteAnimator>();
+    }
+
+#pragma mark Tracks
+    /**
+     * Registers a sprite and returns its track. Nothing plays until `play`.
+     *
+     * @param node      The sprite sheet node to animate
+     * @param anchor    The node giving the world position for culling, if
+     *                  the sprite is nested inside another node
+     */
+    int add(const std::shared_ptr<cugl::scene2::SpriteNode>& node,
+            const std::shared_ptr<cugl::scene2::SceneNode>& anchor = nullptr) {
+        cugl::scene2::SceneNode* place = anchor == nullptr ? node.get() : anchor.get();
+        Track track = { node.get(), place, nullptr, 0, 1, false, true };
+        if (!_free.empty()) {
+            int index = _free.back();
+            _free.pop_back();
+            _tracks[index] = track;
+            return index;
+        }
+        if (_tracks.size() == _tracks.capacity()) {
+            _allocations += 1;
+        }
+        _tracks.push_back(track);
+        return (int)_tracks.size() - 1;
+    }
+
+    /**
+     * Makes room to remove every registered track without allocating. Call
+     * once the level is built; after that only tracks added beyond the
+     * removed ones grow the arrays.
+     */
+    void reserve() {
+        if (_free.capacity() < _tracks.size()) {
+            _free.reserve(_tracks.size());
+            _allocations += 1;
+        }
+    }
+
+    /** Drops a track; must be called before its sprite is destroyed */
+    void remove(int track) {
+        if (track < 0 || track >= _tracks.size() || !_tracks[track].live) {
+            return;
+        }
+        _tracks[track].live = false;
+        _tracks[track].playing = false;
+        _tracks[track].node = nullptr;
+        _tracks[track].anchor = nullptr;
+        if (_free.size() == _free.capacity()) {
+            _allocations += 1;
+        }
+        _free.push_back(track);
+    }
+
+    /**
+     * Loops `clip` on a track. Playing the clip that is already running
+     * carries on where it is; any other clip starts from its first frame.
+     */
+    void play(int track, const AnimationClip* clip, float speed = 1) {
+        if (track < 0 || track >= _tracks.size() || clip == nullptr) {
+            return;
+        }
+        Track& t = _tracks[track];
+        if (!t.playing || t.clip != clip) {
+            t.clip = clip;
+            t.time = 0;
+            t.node->setFrame(clip->frameAt(0));
+        }
+        t.speed = speed;
+        t.playing = true;
+    }
+
+    /** Freezes a track on its current frame */
+    void stop(int track) {
+        if (track >= 0 && track < _tracks.size()) {
+            _tracks[track].playing = false;
+        }
+    }
+
+    bool isPlaying(int track) {
+        return track >= 0 && track < _tracks.size() && _tracks[track].playing;
+    }
+
+#pragma mark Update
+    /**
+     * Limits frame updates to sprites near the camera.
+     *
+     * @param camera    The world rect the active camera shows
+     */
+    void setView(const cugl::Rect& camera) {
+        _view = cugl::Rect(camera.origin.x - ANIM_CULL_MARGIN, camera.origin.y - ANIM_CULL_MARGIN,
+                           camera.size.width + 2 * ANIM_CULL_MARGIN, camera.size.height + 2 * ANIM_CULL_MARGIN);
+        _culling = true;
+    }
+
+    /** Returns whether a world position is close enough to the camera to animate */
+    bool inView(const cugl::Vec2& pos) const {
+        return !_culling || _view.contains(pos);
+    }
+
+    /**
+     * Advances every playing track. Hidden and off-camera sprites keep their
+     * clock but are not touched, so they show the right frame as soon as they
+     * come back.
+     *
+     * @param dt    The amount of time since the last update
+     */
+    void update(float dt) {
+        _advanced = 0;
+        _skipped = 0;
+        for (Track& t : _tracks) {
+            if (!t.playing) {
+                continue;
+            }
+            float duration = t.clip->getDuration();
+            t.time += dt * t.speed;
+            if (duration > 0 && t.time >= duration) {
+                t.time = std::fmod(t.time, duration);
+            }
+            if (!t.node->isVisible() || !inView(t.anchor->getPosition())) {
+                _skipped += 1;
+                continue;
+            }
+            int frame = t.clip->frameAt(t.time);
+            if (frame != t.node->getFrame()) {
+                t.node->setFrame(frame);
+            }
+            _advanced += 1;
+        }
+    }
+
+#pragma mark Instrumentation
+    int getAdvancedLastFrame() {
+        return _advanced;
+    }
+
+    int getSkippedLastFrame() {
+        return _skipped;
+    }
+
+    /** Returns how many times `add`, `remove` or `reserve` allocated */
+    int getAllocations() {
+        return _allocations;
+    }
+
+    /** Returns the number of registered tracks */
+    int size() {
+        return (int)(_tracks.size() - _free.size());
+    }
+};
+
+#endif /* __SPRITE_ANIMATOR_H__ */
@@ -14,6 +14,8 @@
 #include <Level/LevelConstants.h>
 #include <Level/LevelController.h>
 #include <common.h>
+#include <Render/CompressedTextureLoader.h>
+#include <Render/TextureTier.h>
 
 // This keeps us from having to write cugl:: all the time
 using namespace cugl;
@@ -22,6 +24,8 @@ using namespace std;
 #define TIME_STEP 60
 // This is adjusted by screen aspect ratio to get the height
 #define GAME_WIDTH 1024
+// Loads the atlas pages written by tools/atlas_packer.py instead of one file per texture
+// #define TEXTURE_ATLAS
 
 ActiveScene curScene;
 ActiveScene nextScene;
@@ -48,7 +52,8 @@ void App::onStartup() {
     
     // init the assetManager
     _assets->attach<Font>(FontLoader::alloc()->getHook());
-    _assets->attach<Texture>(TextureLoader::alloc()->getHook());
+    // the large sprite sheets load from their compressed copies when there are any
+    _assets->attach<Texture>(CompressedTextureLoader::alloc()->getHook());
     _assets->attach<Sound>(SoundLoader::alloc()->getHook());
     _assets->attach<WidgetValue>(WidgetLoader::alloc()->getHook());
     _assets->attach<scene2::SceneNode>(Scene2Loader::alloc()->getHook());
@@ -56,7 +61,15 @@ void App::onStartup() {
     _assets->attach<LevelController>(GenericLoader<LevelController>::alloc()->getHook());
 
     // load gameplay assets
-    _assets->loadDirectoryAsync("json/assets.json", nullptr);
+#ifdef TEXTURE_ATLAS
+    // same keys, packed textures resolve to regions of the atlas pages
+    _assets->loadDirectoryAsync("json/assets_atlas.json", nullptr);
+#else
+    // reduced copies of the largest textures on low-memory or small devices
+    Size display = getDisplaySize();
+    std::string directory = TextureTier::get().select(display.width / GAME_WIDTH, SDL_GetSystemRAM());
+    _assets->loadDirectoryAsync(directory, nullptr);
+#endif
     
     // Create a sprite batch (and background color) to render the scene
     _batch = SpriteBatch::alloc();
@@ -32,13 +32,13 @@ public:
      * @param size      The width and height of a tile
      * @param color     The tile color
      */
-    CharacterController(Vec2 position, Size size, Color4 color, std::shared_ptr<cugl::scene2::ActionManager> actions, const std::shared_ptr<cugl::AssetManager>& assets) {
-        _view = std::make_unique<CharacterView>(position, size, color, actions, assets);
+    CharacterController(Vec2 position, Size size, Color4 color, std::shared_ptr<cugl::scene2::ActionManager> actions, std::shared_ptr<SpriteAnimator> animator, const std::shared_ptr<cugl::AssetManager>& assets) {
+        _view = std::make_unique<CharacterView>(position, size, color, actions, animator, assets);
         _model = std::make_unique<CharacterModel>(_view->nodePos(), size, color);
     }
     
-    CharacterController(Vec2 position, std::shared_ptr<cugl::scene2::ActionManager> actions, const std::shared_ptr<cugl::AssetManager>& assets) {
-        _view = std::make_unique<CharacterView>(position, Size(20, 20), Color4::BLUE, actions, assets);
+    CharacterController(Vec2 position, std::shared_ptr<cugl::scene2::ActionManager> actions, std::shared_ptr<SpriteAnimator> animator, const std::shared_ptr<cugl::AssetManager>& assets) {
+        _view = std::make_unique<CharacterView>(position, Size(20, 20), Color4::BLUE, actions, animator, assets);
         _model = std::make_unique<CharacterModel>(_view->nodePos(), Size(20, 20), Color4::BLUE);
     }
 
@@ -79,6 +79,10 @@ public:
         _view->stopAnimation();
     }
 
+    bool isAnimating() {
+        return _view->isAnimating();
+    }
+
     void updateLastDirection(Vec2 pos){
         _view->updateLastDirection(pos);
     }
@@ -155,6 +159,10 @@ public:
     void updatePriority(){
         _view->updatePriority();
     }
+
+    cugl::scene2::SceneNode* getNode(){
+        return _view->getNode();
+    }
     
 #pragma mark Controller Methods
 public:
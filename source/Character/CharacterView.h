@@ -8,6 +8,8 @@
 #ifndef CharacterView_h
 #define CharacterView_h
 #include <cugl/cugl.h>
+#include <Animation/SpriteAnimator.h>
+#include <Render/TextureTier.h>
 using namespace cugl;
 
 // This is adjusted by screen aspect ratio to get the height
@@ -25,15 +27,11 @@ private:
     
     /** Manager to process the animation actions */
     std::shared_ptr<cugl::scene2::ActionManager> _actions;
-
-    std::shared_ptr<cugl::scene2::Animate> _c_0;
-    std::shared_ptr<cugl::scene2::Animate> _c_1;
-    std::shared_ptr<cugl::scene2::Animate> _c_2;
-    std::shared_ptr<cugl::scene2::Animate> _c_3;
-    std::shared_ptr<cugl::scene2::Animate> _c_4;
-    std::shared_ptr<cugl::scene2::Animate> _c_5;
-    std::shared_ptr<cugl::scene2::Animate> _c_6;
-    std::shared_ptr<cugl::scene2::Animate> _c_7;
+    
+    /** Ticker that plays the walk animation */
+    std::shared_ptr<SpriteAnimator> _animator;
+    /** Track of the character sprite in the animator */
+    int _track;
 
     // last direction
     int _last_direction;
@@ -44,13 +42,15 @@ private:
 #pragma mark Main Functions
 public:
     /** contructor */
-    CharacterView(Vec2 position, Size size, Color4 color, std::shared_ptr<cugl::scene2::ActionManager> actions, const std::shared_ptr<cugl::AssetManager>& assets){
+    CharacterView(Vec2 position, Size size, Color4 color, std::shared_ptr<cugl::scene2::ActionManager> actions, std::shared_ptr<SpriteAnimator> animator, const std::shared_ptr<cugl::AssetManager>& assets){
 
         _last_direction = 0;
         _actions = actions;
+        _animator = animator;
 
         std::shared_ptr<Texture> character  = assets->get<Texture>("character");
         _node = scene2::SpriteNode::allocWithSheet(character, 8, 8, 64); // SpriteNode for animation
+        TextureTier::get().fit(_node, "character");
 
         _node->setRelativeColor(false);
         _node->setVisible(true);
@@ -59,10 +59,12 @@ public:
         _node->setScale(0.7f);
 
         _node->setFrame(16);
+        _track = _animator->add(_node);
 
 
         std::shared_ptr<Texture> shadow = assets->get<Texture>("shadow");
         _shadow = scene2::PolygonNode::allocWithTexture(shadow);
+        TextureTier::get().fit(_shadow, "shadow");
 
         _node->addChildWithName(_shadow, "shadow");
         _shadow->setScale(0.18f);
@@ -73,6 +75,7 @@ public:
 
         std::shared_ptr<Texture> cross_mark = assets->get<Texture>( "spritesheet_cross_anim");
         _cross_mark = scene2::SpriteNode::allocWithSheet(cross_mark, 2, 4, 8);
+        TextureTier::get().fit(_cross_mark, "spritesheet_cross_anim");
 
         _node->addChildWithName(_cross_mark, "cross_mark");
         _cross_mark->setScale(2.0f);
@@ -85,38 +88,10 @@ public:
         std::vector<int> a = {0,1,1,1,1,1,1,2,2,2,2,2,7};
         _cross_mark_anim = cugl::scene2::Animate::alloc(a, 1.5f);
 
-
-
-        std::vector<int> d0 = {1,2,3,4,5,6,7,0};
-        _c_0 = cugl::scene2::Animate::alloc(d0, DURATION);
-
-        std::vector<int> d1 = {9,10,11,12,13,14,15,8};
-        _c_1 = cugl::scene2::Animate::alloc(d1, DURATION);
-
-        std::vector<int> d2 = {17,18,19,20,21,22,23,16};
-        _c_2 = cugl::scene2::Animate::alloc(d2, DURATION);
-
-        std::vector<int> d3 = {25,26,27,28,29,30,31,24};
-        _c_3 = cugl::scene2::Animate::alloc(d3, DURATION);
-
-        std::vector<int> d4 = {33,34,35,36,37,38,39,32};
-        _c_4 = cugl::scene2::Animate::alloc(d4, DURATION);
-
-        std::vector<int> d5 = {41,42,43,44,45,46,47,40};
-        _c_5 = cugl::scene2::Animate::alloc(d5, DURATION);
-
-        std::vector<int> d6 = {49,50,51,52,53,54,55,48};
-        _c_6 = cugl::scene2::Animate::alloc(d6, DURATION);
-
-        std::vector<int> d7 = {57,58,59,60,61,62,63,56};
-        _c_7 = cugl::scene2::Animate::alloc(d7, DURATION);
-
-
-
-
     }
     
     ~CharacterView(){
+        _animator->remove(_track);
         auto parent = _node->getParent();
         if (parent != nullptr && _node != nullptr) {
             parent->removeChild(_node);
@@ -169,50 +144,30 @@ public:
 
     void updateAnimation(Vec2 target) {
 
-        std::shared_ptr<cugl::scene2::Animate> animation = _c_0;
         Vec2 pos = _node->getPosition();
         int d = calculateMappedAngle(pos.x, pos.y, target.x, target.y);
 
-        if (d == 0) {
-            animation = _c_0;
-        } else if (d == 1){
-            animation = _c_1;
-        }
-        else if (d == 2){
-            animation = _c_2;
-        }
-        else if (d == 3){
-            animation = _c_3;
-        }
-        else if (d == 4){
-            animation = _c_4;
-        }
-        else if (d == 5){
-            animation = _c_5;
-        }else if (d == 6){
-            animation = _c_6;
-        }
-        else if ( d ==7 ){
-            animation = _c_7;
-        }
-
-        _actions->activate("character_animation", animation, _node);
+        const std::shared_ptr<AnimationClip>& clip = AnimationClipSet::character().get(0, d);
+        _animator->play(_track, clip.get());
     }
 
     void stopAnimation() {
-        _actions->remove("character_animation");
+        _animator->stop(_track);
+    }
+
+    bool isAnimating() {
+        return _animator->isPlaying(_track);
     }
 
     void updateLastDirection(Vec2 target) {
         Vec2 pos = _node->getPosition();
         int d = calculateMappedAngle(pos.x, pos.y, target.x, target.y);
 
-        if (!_actions->isActive("character_animation")) {
+        if (!isAnimating()) {
             updateAnimation(target);
-        } else if (_actions->isActive("character_animation") && d == _last_direction) {
+        } else if (d == _last_direction) {
             // continue the animation
-        } else if (_actions->isActive("character_animation") && d != _last_direction) {
-            _actions->remove("character_animation");
+        } else {
             updateAnimation(target);
         }
         _last_direction = d;
@@ -221,6 +176,11 @@ public:
     Vec2 nodePos(){
         return _node->getPosition();
     }
+
+    /** Returns the sprite that is depth sorted in the world */
+    cugl::scene2::SceneNode* getNode(){
+        return _node.get();
+    }
     
     float getAngle(){
         return _node->getAngle();
@@ -10,6 +10,9 @@
 
 #include "GuardView.h"
 #include "GuardModel.h"
+#include "PatrolTimeline.h"
+#include "GuardPursuit.h"
+#include <SlotMap.h>
 // #define DURATION 1.0f
 
 /**
@@ -24,8 +27,14 @@ private:
     std::unique_ptr<GuardModel> _model;
     /** View reference */
     std::unique_ptr<GuardView> _view;
-    /**guards ID**/
-    int _id;
+    /**guards handle in its set**/
+    SlotHandle _handle;
+    /**handle key prefixed with the world, unique across both guard sets**/
+    string _key;
+    /**action keys, built once from the handle**/
+    string _chaseDAction;
+    string _chaseSPAction;
+    string _returnAction;
     /** patrol locations for the guard to follow*/
     vector<Vec2> _patrol_stops;
     //The current stop of the guard (index in _patrol_stops)
@@ -33,7 +42,13 @@ private:
     
     bool _doesPatrol;
     
-    std::shared_ptr<cugl::scene2::MoveTo> _patrolMove;
+    /** patrol loop as a function of time, empty for static guards */
+    PatrolTimeline _timeline;
+    /** time along the patrol loop, in seconds */
+    float _patrol_time;
+    /** the chase move in flight while the guard sees the player */
+    GuardPursuit _pursuit;
+
     std::shared_ptr<cugl::scene2::MoveTo> _chaseMove;
     std::shared_ptr<cugl::scene2::MoveTo> _returnMove;
 
@@ -63,6 +78,12 @@ private:
 
     // should be a value from 0 - 3000, because we use milliseconds
     int _question_value;
+
+    // result of the last vision ray, reused when the scheduler defers it
+    bool _last_visual;
+
+    // whether the guard's world is hidden and it only advances analytically
+    bool _asleep;
     
     //patrol speed
     int _patrol_speed;
@@ -73,8 +94,10 @@ private:
     
 #pragma mark Main Methods
 public:
-    /**view only version of ID**/
-    const int& id;
+    /**view only version of handle**/
+    const SlotHandle& handle;
+    /**view only version of key**/
+    const string& key;
     /**view only version of ID**/
     const bool& doesPatrol;
     /**view only version of return vec**/
@@ -97,8 +120,8 @@ public:
      * @param color     The tile color
      */
     //static guard
-    GuardController(Vec2 position, const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<cugl::scene2::ActionManager> actions, int id, bool isPast, int dir)
-    : id(_id), doesPatrol(_doesPatrol), returnVec(_returnVec), chaseVec(_chaseVec),state(_state), prev_state(_prev_state)
+    GuardController(Vec2 position, const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<cugl::scene2::ActionManager> actions, std::shared_ptr<SpriteAnimator> animator, SlotHandle handle, bool isPast, int dir)
+    : handle(_handle), key(_key), doesPatrol(_doesPatrol), returnVec(_returnVec), chaseVec(_chaseVec),state(_state), prev_state(_prev_state)
     {
         _state = "static";
         _prev_state = "static";
@@ -113,15 +136,19 @@ public:
         _patrol_speed = 53;
         _chase_speed = 120;
         _doesPatrol = false;
-        _id = id;
+        _handle = handle;
+        initKeys(isPast);
 
         _staticDir = dir;
         _if_question_inSP = false;
+        _patrol_time = 0;
 
         _question_value = 0;
+        _last_visual = false;
+        _asleep = false;
 
         // dont move the relative position!!!
-        _view = std::make_unique<GuardView>(position,Size(100, 100), Color4::RED, assets, actions, isPast);
+        _view = std::make_unique<GuardView>(position,Size(100, 100), Color4::RED, assets, actions, animator, isPast);
         _model = std::make_unique<GuardModel>(_view->nodePos(), Size(100, 100), Color4::RED, _staticDir);
         _static_pos = _view->nodePos();
         // dont move the relative position!!!
@@ -129,7 +156,7 @@ public:
     }
     
     //moving guard
-    GuardController(Vec2 position, const std::shared_ptr<cugl::AssetManager>& assets, std::vector<Vec2> vec, std::shared_ptr<cugl::scene2::ActionManager> actions, int id, bool isPast) : id(_id), doesPatrol(_doesPatrol), returnVec(_returnVec), chaseVec(_chaseVec), state(_state), prev_state(_prev_state)
+    GuardController(Vec2 position, const std::shared_ptr<cugl::AssetManager>& assets, std::vector<Vec2> vec, std::shared_ptr<cugl::scene2::ActionManager> actions, std::shared_ptr<SpriteAnimator> animator, SlotHandle handle, bool isPast) : handle(_handle), key(_key), doesPatrol(_doesPatrol), returnVec(_returnVec), chaseVec(_chaseVec), state(_state), prev_state(_prev_state)
     {
         _state = "patrol";
         _prev_state = "patrol";
@@ -147,22 +174,25 @@ public:
         _returnMove = cugl::scene2::MoveTo::alloc();
         _returnMove->setDuration(DURATION);
         
-        _patrolMove = cugl::scene2::MoveTo::alloc();
+        _patrol_time = 0;
         _doesPatrol = true;
         _is_question = false;
         _if_question_inSP = false;
 
 
         _question_value = 0;
+        _last_visual = false;
+        _asleep = false;
 
         // just a placeholder for moving guard
         _staticDir = 0;
 
-        _id = id;
+        _handle = handle;
+        initKeys(isPast);
 
 
         // dont move the relative position!!!
-        _view = std::make_unique<GuardView>(position, Size(128, 128), Color4::RED, assets, actions, isPast);
+        _view = std::make_unique<GuardView>(position, Size(128, 128), Color4::RED, assets, actions, animator, isPast);
         _model = std::make_unique<GuardModel>(_view->nodePos(), Size(128, 128), Color4::RED, 0);
 
         _patrol_stops = vec;
@@ -170,6 +200,7 @@ public:
         for(unsigned int i = 0; i < vecSize; i++) {
             _patrol_stops[i]  = _patrol_stops[i] + (_view->nodeSize() / 2);
         }
+        _timeline.build(_patrol_stops, _patrol_speed);
         _static_pos = _view->nodePos();
         CULog("initial pos: %f, %f", _view->nodePos().x, _view->nodePos().y);
         // dont move the relative position!!!
@@ -179,6 +210,27 @@ public:
 
 
 public:
+    /** Builds the action keys for this guard from its handle */
+    void initKeys(bool isPast) {
+        _key = (isPast ? "past" : "present") + _handle.key();
+        _chaseDAction = "chaseD" + _key;
+        _chaseSPAction = "chaseSP" + _key;
+        _returnAction = "return" + _key;
+    }
+
+    const string& getChaseDAction() {
+        return _chaseDAction;
+    }
+
+    const string& getChaseSPAction() {
+        return _chaseSPAction;
+    }
+
+    const string& getReturnAction() {
+        return _returnAction;
+    }
+
+
     /**
      *  Updates the model and view with position of this tile.
      *
@@ -221,8 +273,29 @@ public:
     
 #pragma mark Update Patrol Methods
     
-    void updatePatrolSpeed(float speed){
-        _patrolMove->setDuration(speed);
+    /**
+     * Moves the guard to where its patrol loop puts it at time `t`.
+     *
+     * @param t  The time along the patrol loop, wrapped to one period
+     */
+    void setPatrolTime(float t){
+        _patrol_time = _timeline.wrap(t);
+        _goingTo = _timeline.stopAfter(_patrol_time);
+        Vec2 pos = _timeline.positionAt(_patrol_time);
+        if (_asleep) {
+            _model->setPosition(pos);
+        }
+        else {
+            updatePosition(pos);
+        }
+    }
+
+    float getPatrolTime(){
+        return _patrol_time;
+    }
+
+    const PatrolTimeline& getTimeline(){
+        return _timeline;
     }
     
 #pragma mark Update Return Methods
@@ -251,6 +324,9 @@ public:
     }
     
     Vec2 getNodePosition(){
+        if (_asleep) {
+            return _model->getPosition();
+        }
         return _view->nodePos();
     }
     
@@ -287,33 +363,17 @@ public:
 
 #pragma mark Controller Methods
 public:
-    //moves the guard to the next patrol stop
-    void nextStop(string actionName){
+    //walks the guard dt seconds further along its patrol loop
+    void advancePatrol(float dt){
         if (returned){
-            _goingTo = saved_stop;
-            returned = false;
-        }
-        else{
-            if (_goingTo + 1 == _patrol_stops.size()){
-                _goingTo = 0;
-            }
-            else{
-                _goingTo += 1;
+            // after a return path the guard stands on the saved stop; if it
+            // never left the loop (e.g. a question) it just carries on
+            if (getNodePosition().distance(_timeline.positionAt(_patrol_time)) > 1) {
+                _patrol_time = _timeline.timeAtStop(saved_stop);
             }
+            returned = false;
         }
-        
-        
-        float distance = getNodePosition().distance(_patrol_stops[_goingTo]);
-        float duration = distance / _patrol_speed;
-        
-        //move guard
-        _patrolMove->setDuration(duration);
-        _patrolMove->setTarget(_patrol_stops[_goingTo]);
-        _view->performAction(actionName, _patrolMove);
-        
-
-        //animate guard
-
+        setPatrolTime(_patrol_time + dt);
     }
     
     void drawPatrolPath(shared_ptr<cugl::Scene2> s){
@@ -331,7 +391,7 @@ public:
         _view->stop_exclamation();
     }
 
-    void updateAnimation(Vec2 target, string state, int last_direction, string last_state, bool valid_target, string id) {
+    void updateAnimation(Vec2 target, string state, int last_direction, string last_state, bool valid_target) {
 
         int direction;
         if (!valid_target and state == "static") {
@@ -344,39 +404,47 @@ public:
             Vec2 pos = _view->nodePos();
             direction = calculateMappedAngle(pos.x, pos.y, target.x, target.y);
         }
-        _view->performAnimation(direction, state, last_direction, last_state, id);
+        _view->performAnimation(direction, state, last_direction, last_state);
         _model->setDirection(direction);
 
 
     }
 
-    void stopQuestionAnim(string id){
-        _view->stopQuestionAnim(id);
+    void stopAnimation(){
+        _view->stopAnimation();
+    }
+
+    bool updateOnScreen(){
+        return _view->updateOnScreen();
+    }
+
+    void stopQuestionAnim(){
+        _view->stopQuestionAnim();
     }
 
-    void lookAroundAnim(string id) {
-        updateAnimation(Vec2(0,0), _state, _model->getDirection(), _prev_state, false, id);
+    void lookAroundAnim() {
+        updateAnimation(Vec2(0,0), _state, _model->getDirection(), _prev_state, false);
     }
-    void questionAnim(string id, float time) {
-        updateAnimation(Vec2(0,0), _state, _model->getDirection(), _prev_state, false,id);
+    void questionAnim(float time) {
+        updateAnimation(Vec2(0,0), _state, _model->getDirection(), _prev_state, false);
         // question animation
-        _view->startQuestionAnim(id, time);
+        _view->startQuestionAnim(time);
     }
 
-    void staticGuardAnim(string id) {
-        updateAnimation(Vec2(0,0), _state, _model->getDirection(), _prev_state, false, id);
+    void staticGuardAnim() {
+        updateAnimation(Vec2(0,0), _state, _model->getDirection(), _prev_state, false);
     }
 
-    void chaseGuardAnim(string id) {
-        updateAnimation(_chaseMove->getTarget(), _state, _model->getDirection(), _prev_state, true, id);
+    void chaseGuardAnim() {
+        updateAnimation(_chaseMove->getTarget(), _state, _model->getDirection(), _prev_state, true);
     }
 
-    void patrolGuardAnim(string id) {
-        updateAnimation(_patrolMove->getTarget(), _state, _model->getDirection(), _prev_state, true, id);
+    void patrolGuardAnim() {
+        updateAnimation(_patrol_stops[_goingTo], _state, _model->getDirection(), _prev_state, true);
     }
 
-    void returnGuardAnim(string id) {
-        updateAnimation(_returnMove->getTarget(), _state, _model->getDirection(), _prev_state, true, id);
+    void returnGuardAnim() {
+        updateAnimation(_returnMove->getTarget(), _state, _model->getDirection(), _prev_state, true);
     }
 
     void chaseChar(string actionName){
@@ -400,6 +468,10 @@ public:
         _view->performAction(actionName, _returnMove);
     }
     
+    Vec2 getReturnTarget(){
+        return _returnMove->getTarget();
+    }
+
     void prependReturnVec(Vec2 pos){
         _returnVec.insert(_returnVec.begin(), pos);
     }
@@ -432,6 +504,14 @@ public:
         return _question_value;
     }
 
+    void setLastVisual(bool value) {
+        _last_visual = value;
+    }
+
+    bool getLastVisual() {
+        return _last_visual;
+    }
+
     int getDirection() {
         return _model->getDirection();
     }
@@ -455,13 +535,21 @@ public:
     
     void updateChaseSpeed(int s){
         if (_chase_speed < 181){
-            _chase_speed += s;
+            _chase_speed = std::min(181, _chase_speed + s);
         }
     }
     
     void setChaseSpeed(int s){
         _chase_speed = s;
     }
+    
+    int getChaseSpeed(){
+        return _chase_speed;
+    }
+    
+    GuardPursuit& getPursuit(){
+        return _pursuit;
+    }
 
 
 //    int getIsQuestion() {
@@ -520,6 +608,111 @@ public:
     void updatePriority(){
         _view->updatePriority();
     }
+
+    cugl::scene2::SceneNode* getNode(){
+        return _view->getNode();
+    }
+
+#pragma mark Restart Methods
+    /**
+     * Puts the guard back the way it was built: at its post or first stop,
+     * with fresh state and timers. The view and its nodes are kept. The
+     * caller drops the guard's actions first.
+     */
+    void reset() {
+        _state = _doesPatrol ? "patrol" : "static";
+        _prev_state = _state;
+        _state_before_question = "";
+        _returnVec.clear();
+        _chaseVec.clear();
+        _chase_speed = 120;
+        _is_question = false;
+        _if_question_inSP = false;
+        _question_value = 0;
+        _last_visual = false;
+        _asleep = false;
+        _patrol_time = 0;
+        _goingTo = 0;
+        saved_stop = _doesPatrol ? 1 : 0;
+        returned = false;
+        _pursuit.reset();
+        _model->setDirection(_staticDir);
+        updatePosition(_static_pos);
+        _view->reset();
+    }
+
+#pragma mark Inactive World Methods
+    /**
+     * Switches the guard to the reduced update used while its world is hidden.
+     * Only the model position is advanced from then on.
+     */
+    void sleep() {
+        _asleep = true;
+    }
+
+    /**
+     * Puts the view back where the model got to. The next `patrol` call picks
+     * the movement and animation up from here.
+     */
+    void wake() {
+        if (!_asleep) {
+            return;
+        }
+        _asleep = false;
+        _view->setPosition(_model->getPosition());
+    }
+
+    bool isAsleep() {
+        return _asleep;
+    }
+
+    /** Copies the model position to the view, e.g. when the world is previewed */
+    void syncView() {
+        _view->setPosition(_model->getPosition());
+    }
+
+    /**
+     * Walks the guard along its return path or patrol route without actions.
+     *
+     * @param dt  The amount of time since the last update
+     */
+    void updateInactive(float dt) {
+        if (_state == "patrol" && _doesPatrol) {
+            advancePatrol(dt);
+            Vec2 heading = _timeline.headingAt(_patrol_time);
+            _model->setDirection(calculateMappedAngle(0, 0, heading.x, heading.y));
+            return;
+        }
+        if (_state != "return") {
+            return;
+        }
+
+        float travel = _patrol_speed * dt;
+        while (travel > 0 && !_returnVec.empty()) {
+            Vec2 target = _returnVec[0];
+            Vec2 pos = _model->getPosition();
+            float left = pos.distance(target);
+            if (left > 0) {
+                _model->setDirection(calculateMappedAngle(pos.x, pos.y, target.x, target.y));
+            }
+            if (left > travel) {
+                _model->setPosition(pos + (target - pos) * (travel / left));
+                return;
+            }
+            _model->setPosition(target);
+            travel -= left;
+            eraseReturnVec();
+        }
+
+        if (_returnVec.empty()) {
+            _prev_state = _state;
+            _state = _doesPatrol ? "patrol" : "static";
+            if (_doesPatrol) {
+                // spend what is left of the frame on the loop
+                advancePatrol(travel / _patrol_speed);
+            }
+        }
+    }
 };
 
 #endif /* __GUARD_CONTROLLER_H__ */
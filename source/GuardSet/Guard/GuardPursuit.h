@@ -0,0 +1,148 @@
+//
+//  GuardPursuit.h
+//  Tilemap
+//
+//  Intercept targeting for guards that can see the player. The player's
+//  queued path gives where it will be over the next second; a chasing guard
+//  heads for the first point it can reach in time and keeps that move until
+//  the player strays too far from the prediction.
+//
+
+#ifndef __GUARD_PURSUIT_H__
+#define __GUARD_PURSUIT_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <algorithm>
+
+/** Waypoints of the player's path considered for a prediction */
+#define PURSUIT_LOOKAHEAD   12
+/** How far ahead an intercept is searched for, in seconds */
+#define PURSUIT_HORIZON     1.0f
+/** Time steps the search is split into */
+#define PURSUIT_STEPS       30
+/** How far the player may be from the prediction before the guard re-plans */
+#define PURSUIT_ERROR       40.0f
+/** Longest single chase move */
+#define PURSUIT_SEGMENT     250.0f
+/** Halvings used to find the clear part of a blocked move */
+#define PURSUIT_CLEAR_STEPS 6
+/** A clear part shorter than this falls back to a direct step at the player */
+#define PURSUIT_MIN_MOVE    25.0f
+
+/**
+ * Where the player is headed: the waypoints still ahead of it, each
+ * reached `legTime` seconds after the previous one.
+ */
+class PlayerMotion {
+private:
+    std::vector<cugl::Vec2> _waypoints;
+    float _legTime;
+
+public:
+    PlayerMotion() : _legTime(0) {}
+
+    PlayerMotion(const std::vector<cugl::Vec2>& waypoints, float legTime) : _legTime(legTime) {
+        size_t count = std::min(waypoints.size(), (size_t)PURSUIT_LOOKAHEAD);
+        _waypoints.assign(waypoints.begin(), waypoints.begin() + count);
+    }
+
+    const std::vector<cugl::Vec2>& getWaypoints() const {
+        return _waypoints;
+    }
+
+    float getLegTime() const {
+        return _legTime;
+    }
+
+    bool operator==(const PlayerMotion& other) const {
+        return _legTime == other._legTime && _waypoints == other._waypoints;
+    }
+
+    /**
+     * Returns where the player will be `t` seconds from now.
+     *
+     * @param start The player's current position
+     * @param t     Seconds ahead
+     */
+    cugl::Vec2 positionAt(cugl::Vec2 start, float t) const {
+        if (_waypoints.empty() || _legTime <= 0) {
+            return start;
+        }
+        int leg = (int)(t / _legTime);
+        if (leg >= _waypoints.size()) {
+            return _waypoints.back();
+        }
+        cugl::Vec2 from = leg == 0 ? start : _waypoints[leg - 1];
+        float f = (t - leg * _legTime) / _legTime;
+        return from + (_waypoints[leg] - from) * f;
+    }
+};
+
+/** The chase move a guard has committed to and the prediction behind it */
+class GuardPursuit {
+private:
+    PlayerMotion _motion;
+    /** Player position when the move was issued */
+    cugl::Vec2 _origin;
+    /** Simulated time the move was issued at */
+    float _issued;
+    bool _active;
+
+public:
+    GuardPursuit() : _issued(0), _active(false) {}
+
+    /**
+     * Returns the first point along the player's motion the guard can reach
+     * by the time the player gets there, or the end of the horizon.
+     */
+    static cugl::Vec2 intercept(cugl::Vec2 guard, float speed, cugl::Vec2 player, const PlayerMotion& motion) {
+        for (int k = 1; k <= PURSUIT_STEPS; k++) {
+            float t = PURSUIT_HORIZON * k / PURSUIT_STEPS;
+            cugl::Vec2 p = motion.positionAt(player, t);
+            if (guard.distance(p) <= speed * t) {
+                return p;
+            }
+        }
+        return motion.positionAt(player, PURSUIT_HORIZON);
+    }
+
+    /**
+     * Picks the next chase move and remembers the prediction it is based on.
+     *
+     * @param guard     The guard position
+     * @param speed     The guard chase speed
+     * @param player    The player position
+     * @param motion    Where the player is headed
+     * @param now       The simulated time
+     *
+     * @return the target of the move, at most PURSUIT_SEGMENT away
+     */
+    cugl::Vec2 plan(cugl::Vec2 guard, float speed, cugl::Vec2 player, const PlayerMotion& motion, float now) {
+        _motion = motion;
+        _origin = player;
+        _issued = now;
+        _active = true;
+
+        cugl::Vec2 aim = intercept(guard, speed, player, motion);
+        float distance = guard.distance(aim);
+        if (distance < 1) {
+            return guard;
+        }
+        return guard + (aim - guard) / distance * std::min(distance, PURSUIT_SEGMENT);
+    }
+
+    /** Returns how far the player is from where the plan expected it */
+    float error(cugl::Vec2 player, float now) const {
+        if (!_active) {
+            return 0;
+        }
+        return _motion.positionAt(_origin, now - _issued).distance(player);
+    }
+
+    void reset() {
+        _active = false;
+    }
+};
+
+#endif /* __GUARD_PURSUIT_H__ */
@@ -9,6 +9,8 @@
 #define GuardView_h
 
 #include <cugl/cugl.h>
+#include <Animation/SpriteAnimator.h>
+#include <Render/TextureTier.h>
 using namespace cugl;
 
 #include <math.h>
@@ -31,8 +33,13 @@ private:
 
     // questions mark
     std::shared_ptr<scene2::SpriteNode> _question_node;
-    std::vector<int> q_anim = {1,2,3,4,5,6,7,0};
-    std::shared_ptr<cugl::scene2::Animate> q_animation = cugl::scene2::Animate::alloc(q_anim, 1.0f);
+
+    /** Ticker that plays the body animation */
+    std::shared_ptr<SpriteAnimator> _animator;
+    /** Track of the body sprite in the animator */
+    int _track;
+    /** Whether the guard is near the camera; effects pause while it is not */
+    bool _onScreen;
 
 
 
@@ -46,9 +53,10 @@ private:
 #pragma mark Main Functions
 public:
     /** contructor */
-    GuardView(Vec2 position, Size size, Color4 color, const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<cugl::scene2::ActionManager> actions, bool isPast) {
+    GuardView(Vec2 position, Size size, Color4 color, const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<cugl::scene2::ActionManager> actions, std::shared_ptr<SpriteAnimator> animator, bool isPast) {
         // Get the image and add it to the node.
         _actions = actions;
+        _animator = animator;
         float scale = GAME_WIDTH/size.width;
         // size *= scale;
         string a;
@@ -61,18 +69,22 @@ public:
         }
         std::shared_ptr<Texture> guard  = assets->get<Texture>(a);
         _node = scene2::SpriteNode::allocWithSheet(guard, 16, 16, 256); // SpriteNode for animation
+        TextureTier::get().fit(_node, a);
         _node->setScale(0.6f); // Magic number to rescale asset
 
         _node->setRelativeColor(false);
         _node->setVisible(true);
         _node->setAnchor(Vec2::ANCHOR_CENTER);
         _node->setPosition(position + _node->getSize()/2);
+        _track = _animator->add(_node);
+        _onScreen = true;
 
 
 
 
         std::shared_ptr<Texture> question = assets->get<Texture>("question_mark_anim");
         _question_node = scene2::SpriteNode::allocWithSheet(question, 1,8,8);
+        TextureTier::get().fit(_question_node, "question_mark_anim");
         _question_node->setVisible(false);
         _question_node->setScale(.5f);
         Vec2 vec = Vec2(120,200);
@@ -84,6 +96,7 @@ public:
 
         std::shared_ptr<Texture> shadow = assets->get<Texture>("shadow");
         _shadow = scene2::PolygonNode::allocWithTexture(shadow);
+        TextureTier::get().fit(_shadow, "shadow");
 
         _node->addChildWithName(_shadow, "shadow");
         _shadow->setScale(0.2f);
@@ -94,6 +107,7 @@ public:
 
         std::shared_ptr<Texture> exclamation = assets->get<Texture>("exclamation_mark");
         _exclamation_node = scene2::PolygonNode::allocWithTexture(exclamation);
+        TextureTier::get().fit(_exclamation_node, "exclamation_mark");
 
         _node->addChildWithName(_exclamation_node, "exclamation");
         _exclamation_node->setScale(.5f);
@@ -105,6 +119,7 @@ public:
     }
     
     ~GuardView(){
+        _animator->remove(_track);
         auto parent = _node->getParent();
         if (parent != nullptr && _node != nullptr) {
             parent->removeChild(_node);
@@ -135,7 +150,9 @@ public:
 #pragma mark Setters
 public:
     void start_exclamation() {
-        _exclamation_node->setVisible(true);
+        if (_onScreen) {
+            _exclamation_node->setVisible(true);
+        }
     };
 
     void stop_exclamation() {
@@ -154,6 +171,11 @@ public:
     Vec2 nodePos(){
         return _node->getPosition();
     }
+
+    /** Returns the sprite that is depth sorted in the world */
+    scene2::SceneNode* getNode(){
+        return _node.get();
+    }
     
     Size nodeSize() {
         return _node->getSize();
@@ -164,7 +186,7 @@ public:
         _question_node->setVisible(false);
     }
 
-    void stopQuestionAnim(string id){
+    void stopQuestionAnim(){
         // _actions->remove("question"+id);
         _question_node->setVisible(false);
     }
@@ -187,7 +209,11 @@ public:
 //        }
 //    }
 //
-    void startQuestionAnim(string id, float time){
+    void startQuestionAnim(float time){
+        if (!_onScreen) {
+            // the frame follows the question value, so it catches up on return
+            return;
+        }
         _question_node->setVisible(true);
         // CULog("%s  %f", id.c_str(), time);
         int num_frame = (time * 8) / 3000;
@@ -197,57 +223,53 @@ public:
         _question_node->setFrame(num_frame);
     }
 
-    void performAnimation(int current_d, string state, int last_direction, string last_state, string id) {
+    void performAnimation(int current_d, string state, int last_direction, string last_state) {
         //CULog("%d", d);
-        if (_actions->isActive("guard_animation"+id) and current_d == last_direction and state == last_state) {
-            // continue the current animation
-            return;
-        }
-
-        if (_actions->isActive("guard_animation"+id) and (current_d != last_direction or state != last_state)) {
-            _actions->remove("guard_animation"+id);
-       //     CULog("remove current animation, start a new one curent d:%d last d: %d  current state: %s   last state: %s", current_d, last_direction, state.c_str(), last_state.c_str());
-        }
-
         int direction;
-        // walk or run or lookaround or static. this is the starting index in spritesheet
-        int start_index;
-        float duration;
+        // walk or run or lookaround or static. this is the row in spritesheet
+        int row;
 
         if (state == "chaseD" or state == "chaseSP") {
             // running
-            start_index = 64;
+            row = GUARD_CLIP_RUN;
             direction = current_d;
-            duration = 0.5f;
         } else if (state == "patrol" or state=="return") {
             // walking
-            start_index = 0;
+            row = GUARD_CLIP_WALK;
             direction = current_d;
-            duration = 1.0f;
         } else if (state == "lookaround") {
             // look around, need to use the last direction as the direction
-            start_index =  128;
+            row = GUARD_CLIP_LOOK;
             direction = last_direction;
-            duration = 1.0f;
-        } else if (state == "static" or state == "question") {
-            start_index = 192;
+        } else {
+            // static or question
+            row = GUARD_CLIP_IDLE;
             direction = last_direction;
-            duration = 1.0f;
-        }
-        // looping frames
-        std::vector<int> frames;
-        for(int ii = 1 + start_index + 8*direction; ii < 8 + start_index + 8*direction; ii++) {
-            frames.push_back(ii);
         }
-        frames.push_back(start_index + 8*direction);
 
-        std::shared_ptr<cugl::scene2::Animate> animation = cugl::scene2::Animate::alloc(frames, duration);
-//        CULog("animation cycle");
-//        for(int i=0; i < frames.size(); i++) {
-//            CULog( "%d",frames.at(i));
-//        }
-        _actions->activate("guard_animation"+id, animation, _node);
+        // clips are shared by every guard, nothing is allocated here; the
+        // animator keeps running the clip if it is the one already playing
+        const std::shared_ptr<AnimationClip>& clip = AnimationClipSet::guard().get(row, direction);
+        _animator->play(_track, clip.get());
+    }
+
+    void stopAnimation() {
+        _animator->stop(_track);
+    }
+
+    /** Clears the animation and effects for a restart, keeping the nodes */
+    void reset() {
+        stopAnimation();
+        stopQuestionAnim();
+        stop_exclamation();
+        _onScreen = true;
+        _node->setVisible(true);
+    }
 
+    /** Re-evaluates whether this guard is close enough to the camera to animate */
+    bool updateOnScreen() {
+        _onScreen = _animator->inView(_node->getPosition());
+        return _onScreen;
     }
     
 #pragma mark Helpers
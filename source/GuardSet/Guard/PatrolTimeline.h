@@ -0,0 +1,130 @@
+//
+//  PatrolTimeline.h
+//  Tilemap
+//
+//  The patrol loop of a moving guard as a function of time. Built once from
+//  the cumulative arc length of the loop, so the position and heading at any
+//  time come from a binary search over the leg start times plus a lerp.
+//
+
+#ifndef __PATROL_TIMELINE_H__
+#define __PATROL_TIMELINE_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace cugl;
+
+class PatrolTimeline {
+private:
+    /** The stops of the loop, the last leg walks back to the first stop */
+    std::vector<Vec2> _stops;
+    /** _times[k] is when the guard reaches stop k, _times[n] closes the loop */
+    std::vector<float> _times;
+
+public:
+    PatrolTimeline() {}
+
+    /**
+     * Rebuilds the timeline for a loop walked at constant speed.
+     *
+     * @param stops The patrol stops, in walking order
+     * @param speed The walking speed in points per second
+     */
+    void build(const std::vector<Vec2>& stops, float speed) {
+        _stops = stops;
+        _times.clear();
+        if (stops.empty() || speed <= 0) {
+            _stops.clear();
+            return;
+        }
+
+        float t = 0;
+        _times.push_back(t);
+        for (size_t k = 0; k < stops.size(); k++) {
+            const Vec2& next = stops[(k + 1) % stops.size()];
+            t += stops[k].distance(next) / speed;
+            _times.push_back(t);
+        }
+    }
+
+    bool isEmpty() const {
+        return _stops.empty();
+    }
+
+    /** Returns the time one full loop takes */
+    float getPeriod() const {
+        return _times.empty() ? 0 : _times.back();
+    }
+
+    /** Maps any time onto [0, period) */
+    float wrap(float t) const {
+        float period = getPeriod();
+        if (period <= 0) {
+            return 0;
+        }
+        t = std::fmod(t, period);
+        if (t < 0) {
+            t += period;
+        }
+        return t;
+    }
+
+    /** Returns the time at which the guard stands on the given stop */
+    float timeAtStop(int stop) const {
+        if (_stops.empty()) {
+            return 0;
+        }
+        return _times[stop % _stops.size()];
+    }
+
+    /** Returns the leg walked at time `t`; leg k goes from stop k to k+1 */
+    int legAt(float t) const {
+        if (_stops.size() < 2) {
+            return 0;
+        }
+        auto it = std::upper_bound(_times.begin() + 1, _times.end(), wrap(t));
+        int leg = (int)(it - _times.begin()) - 1;
+        return std::min(leg, (int)_stops.size() - 1);
+    }
+
+    /** Returns the stop the guard is heading for at time `t` */
+    int stopAfter(float t) const {
+        if (_stops.empty()) {
+            return 0;
+        }
+        return (legAt(t) + 1) % _stops.size();
+    }
+
+    /** Returns the guard position at time `t` */
+    Vec2 positionAt(float t) const {
+        if (_stops.empty()) {
+            return Vec2(0, 0);
+        }
+        if (_stops.size() == 1) {
+            return _stops[0];
+        }
+        t = wrap(t);
+        int leg = legAt(t);
+        const Vec2& a = _stops[leg];
+        const Vec2& b = _stops[(leg + 1) % _stops.size()];
+        float length = _times[leg + 1] - _times[leg];
+        float alpha = length > 0 ? (t - _times[leg]) / length : 1;
+        return a + (b - a) * alpha;
+    }
+
+    /** Returns the unit walking direction at time `t`, or zero when standing */
+    Vec2 headingAt(float t) const {
+        if (_stops.size() < 2) {
+            return Vec2(0, 0);
+        }
+        int leg = legAt(t);
+        Vec2 dir = _stops[(leg + 1) % _stops.size()] - _stops[leg];
+        float length = dir.length();
+        return length > 0 ? dir / length : Vec2(0, 0);
+    }
+};
+
+#endif /* __PATROL_TIMELINE_H__ */
@@ -0,0 +1,204 @@
+//
+//  GuardCrowd.h
+//  Tilemap
+//
+//  Local avoidance between the guards of one world. A spatial hash rebuilt
+//  every frame gives each guard its close neighbours in O(n), and nav nodes
+//  on the routes of guards chasing by shortest path are reserved, so the
+//  next chaser sidesteps onto free nodes instead of stacking behind them.
+//
+
+#ifndef __GUARD_CROWD_H__
+#define __GUARD_CROWD_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <cmath>
+
+using namespace cugl;
+
+/** Guards closer than this push each other apart */
+#define CROWD_RADIUS        48.0f
+/** Longest separation offset added to a chase move */
+#define CROWD_MAX_PUSH      32.0f
+
+class GuardCrowd {
+private:
+    /** Guard positions this frame */
+    std::vector<Vec2> _positions;
+    /** Hash cell of each guard */
+    std::vector<int> _cellX;
+    std::vector<int> _cellY;
+    /** First guard in each bucket, -1 if empty */
+    std::vector<int> _head;
+    /** Next guard in the same bucket */
+    std::vector<int> _next;
+
+    /** Neighbours of each nav node */
+    std::vector<std::vector<int>> _adjacency;
+    bool** _adjMatrix;
+    /** Guards whose route runs through each nav node */
+    std::vector<int> _claims;
+    /** Nodes reserved by each guard */
+    std::vector<std::vector<int>> _reserved;
+
+    int bucket(int x, int y) const {
+        unsigned int h = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u;
+        return (int)(h & (_head.size() - 1));
+    }
+
+public:
+    GuardCrowd() : _adjMatrix(nullptr) {}
+
+    /**
+     * Builds adjacency lists from the nav graph.
+     *
+     * @param adjMatrix The nav graph adjacency matrix
+     * @param n         The number of nav nodes
+     */
+    void init(bool** adjMatrix, int n) {
+        _adjMatrix = adjMatrix;
+        _adjacency.assign(n, std::vector<int>());
+        for (int u = 0; u < n && adjMatrix != nullptr; u++) {
+            for (int v = 0; v < n; v++) {
+                if (adjMatrix[u][v]) {
+                    _adjacency[u].push_back(v);
+                }
+            }
+        }
+        _claims.assign(n, 0);
+        _reserved.clear();
+    }
+
+#pragma mark Separation
+    /** Re-hashes every guard; call once per frame before `separation` */
+    void rebuild(const std::vector<Vec2>& positions) {
+        int n = (int)positions.size();
+        _positions = positions;
+        size_t buckets = 1;
+        while (buckets < 2 * n) {
+            buckets <<= 1;
+        }
+        _head.assign(buckets, -1);
+        _next.assign(n, -1);
+        _cellX.resize(n);
+        _cellY.resize(n);
+        for (int i = 0; i < n; i++) {
+            _cellX[i] = (int)std::floor(positions[i].x / CROWD_RADIUS);
+            _cellY[i] = (int)std::floor(positions[i].y / CROWD_RADIUS);
+            int b = bucket(_cellX[i], _cellY[i]);
+            _next[i] = _head[b];
+            _head[b] = i;
+        }
+    }
+
+    /**
+     * Returns how far guard `i` should shift to clear its neighbours, at
+     * most CROWD_MAX_PUSH long.
+     */
+    Vec2 separation(int i) const {
+        if (i < 0 || i >= _positions.size()) {
+            return Vec2::ZERO;
+        }
+        Vec2 push = Vec2::ZERO;
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                int cx = _cellX[i] + dx;
+                int cy = _cellY[i] + dy;
+                for (int j = _head[bucket(cx, cy)]; j != -1; j = _next[j]) {
+                    if (j == i || _cellX[j] != cx || _cellY[j] != cy) {
+                        continue;
+                    }
+                    Vec2 away = _positions[i] - _positions[j];
+                    float d = away.length();
+                    if (d >= CROWD_RADIUS) {
+                        continue;
+                    }
+                    if (d < 0.01f) {
+                        // on top of each other, split them by index
+                        away = Vec2(i < j ? 1.0f : -1.0f, 0);
+                        d = 1;
+                    }
+                    push += away / d * (CROWD_RADIUS - d);
+                }
+            }
+        }
+        if (push.length() > CROWD_MAX_PUSH) {
+            push = push.getNormalization() * CROWD_MAX_PUSH;
+        }
+        return push;
+    }
+
+#pragma mark Node Reservation
+    /**
+     * Moves a route off nodes other guards have reserved where a free node
+     * joins the same neighbours, so no new search is needed.
+     *
+     * @param guard The guard the route is for
+     * @param route Nav nodes from start to goal
+     */
+    std::vector<int> spread(int guard, std::vector<int> route) const {
+        for (int k = 1; k + 1 < route.size(); k++) {
+            int node = route[k];
+            int own = isReservedBy(guard, node) ? 1 : 0;
+            if (_claims[node] - own <= 0) {
+                continue;
+            }
+            for (int w : _adjacency[route[k - 1]]) {
+                if (w != node && _claims[w] == 0 && _adjMatrix[w][route[k + 1]]) {
+                    route[k] = w;
+                    break;
+                }
+            }
+        }
+        return route;
+    }
+
+    /** Reserves the nodes of `route` for `guard`, replacing its old route */
+    void claim(int guard, const std::vector<int>& route) {
+        release(guard);
+        if (guard >= _reserved.size()) {
+            _reserved.resize(guard + 1);
+        }
+        for (int node : route) {
+            _claims[node] += 1;
+        }
+        _reserved[guard] = route;
+    }
+
+    /** Frees the nodes reserved by `guard` */
+    void release(int guard) {
+        if (guard >= _reserved.size()) {
+            return;
+        }
+        for (int node : _reserved[guard]) {
+            _claims[node] -= 1;
+        }
+        _reserved[guard].clear();
+    }
+
+    void releaseAll() {
+        for (int g = 0; g < _reserved.size(); g++) {
+            release(g);
+        }
+    }
+
+    bool isReservedBy(int guard, int node) const {
+        if (guard >= _reserved.size()) {
+            return false;
+        }
+        for (int n : _reserved[guard]) {
+            if (n == node) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Returns how many guards have `node` on their route */
+    int claimsAt(int node) const {
+        return node >= 0 && node < _claims.size() ? _claims[node] : 0;
+    }
+};
+
+#endif /* __GUARD_CROWD_H__ */
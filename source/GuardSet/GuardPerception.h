@@ -0,0 +1,142 @@
+//
+//  GuardPerception.h
+//  Tilemap
+//
+//  Level of detail for guard perception. Guards near the player, on screen
+//  near it, or already alert perceive every tick; guards further out only
+//  every few ticks; far guards off screen not at all, since nothing they
+//  could see or hear reaches that far. Tier boundaries come from
+//  json/tuning.json.
+//
+
+#ifndef __GUARD_PERCEPTION_H__
+#define __GUARD_PERCEPTION_H__
+
+#include <cugl/cugl.h>
+#include <algorithm>
+
+/** Perception tiers, nearest first */
+#define PERCEPTION_NEAR     0
+#define PERCEPTION_MID      1
+#define PERCEPTION_FAR      2
+
+/** Tier boundaries, read from the "perception" object of the tuning file */
+struct PerceptionTuning {
+    /** Guards closer to the player than this perceive every tick */
+    float near;
+    /** Guards further than this and off screen skip perception */
+    float far;
+    /** Ticks between checks of a mid-range guard */
+    int midInterval;
+
+    PerceptionTuning() : near(350), far(900), midInterval(4) {}
+};
+
+class GuardPerception {
+private:
+    PerceptionTuning _tuning;
+    unsigned long _tick;
+    /** Guards per tier this tick */
+    int _counts[3];
+    /** Mid guards that were due this tick */
+    int _midChecked;
+    /** Guards per tier summed over all ticks */
+    long _totals[3];
+
+public:
+    GuardPerception() : _tuning(loadTuning()), _tick(0), _midChecked(0) {
+        std::fill(_counts, _counts + 3, 0);
+        std::fill(_totals, _totals + 3, 0);
+    }
+
+    /** Returns the tuning in json/tuning.json, read once, or the defaults */
+    static const PerceptionTuning& loadTuning() {
+        static PerceptionTuning tuning = [] {
+            PerceptionTuning t;
+            std::shared_ptr<cugl::JsonReader> reader = cugl::JsonReader::allocWithAsset("json/tuning.json");
+            std::shared_ptr<cugl::JsonValue> json = reader == nullptr ? nullptr : reader->readJson();
+            if (json == nullptr || !json->has("perception")) {
+                CULog("no perception tuning, using defaults");
+                return t;
+            }
+            std::shared_ptr<cugl::JsonValue> p = json->get("perception");
+            t.near = p->get("near") == nullptr ? t.near : p->get("near")->asFloat(t.near);
+            t.far = p->get("far") == nullptr ? t.far : p->get("far")->asFloat(t.far);
+            t.midInterval = p->get("mid_interval") == nullptr ? t.midInterval : std::max(1, p->get("mid_interval")->asInt(t.midInterval));
+            return t;
+        }();
+        return tuning;
+    }
+
+    const PerceptionTuning& getTuning() const {
+        return _tuning;
+    }
+
+    void setTuning(const PerceptionTuning& tuning) {
+        _tuning = tuning;
+    }
+
+    /** Restarts the tick count, so mid tier guards take their turns as in a new set */
+    void reset() {
+        _tick = 0;
+        std::fill(_counts, _counts + 3, 0);
+        _midChecked = 0;
+    }
+
+    /** Starts a tick; counters describe the last finished one until then */
+    void beginTick() {
+        _tick += 1;
+        std::fill(_counts, _counts + 3, 0);
+        _midChecked = 0;
+    }
+
+    /**
+     * Returns the tier of a guard.
+     *
+     * @param distance  The guard's distance to the player
+     * @param onScreen  Whether the guard is near the camera
+     * @param alert     Whether the guard is questioning or chasing
+     */
+    int tier(float distance, bool onScreen, bool alert) const {
+        if (alert || distance <= _tuning.near) {
+            return PERCEPTION_NEAR;
+        }
+        if (distance > _tuning.far && !onScreen) {
+            return PERCEPTION_FAR;
+        }
+        return PERCEPTION_MID;
+    }
+
+    /**
+     * Records guard `i` in `tier` and returns whether it perceives this tick.
+     * Mid guards are spread over the interval by index.
+     */
+    bool perceives(int i, int tier) {
+        _counts[tier] += 1;
+        _totals[tier] += 1;
+        if (tier == PERCEPTION_NEAR) {
+            return true;
+        }
+        if (tier == PERCEPTION_MID && (_tick + i) % _tuning.midInterval == 0) {
+            _midChecked += 1;
+            return true;
+        }
+        return false;
+    }
+
+#pragma mark Profiling
+    int getCount(int tier) const {
+        return _counts[tier];
+    }
+
+    long getTotal(int tier) const {
+        return _totals[tier];
+    }
+
+    /** Returns how many guards actually ran perception last tick */
+    int getPerceivedLastTick() const {
+        return _counts[PERCEPTION_NEAR] + _midChecked;
+    }
+};
+
+#endif /* __GUARD_PERCEPTION_H__ */
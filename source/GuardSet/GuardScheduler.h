@@ -0,0 +1,202 @@
+//
+//  GuardScheduler.h
+//  Tilemap
+//
+//  Spreads the expensive guard "think" work (vision ray casts, shortest path
+//  re-plans, lookaround resolution) across frames under a fixed budget.
+//
+
+#ifndef __GUARD_SCHEDULER_H__
+#define __GUARD_SCHEDULER_H__
+
+#include <vector>
+#include <algorithm>
+
+/** Work units charged for one vision ray cast against the obstacle set */
+#define AI_COST_RAY         1
+/** Work units charged for one shortest path search over the nav graph */
+#define AI_COST_REPLAN      8
+/** Default number of work units a guard set may spend in one frame */
+#define AI_FRAME_BUDGET     24
+/** Priority bonus for guards that are questioning or chasing */
+#define AI_ALERT_PRIORITY   100000.0f
+/** Priority bonus per frame a guard has been starved of budget */
+#define AI_AGING_PRIORITY   200.0f
+
+/**
+ * A per-frame budget for guard AI work.
+ *
+ * At the start of every frame the guard set registers each guard with a
+ * priority (lower is more urgent), then walks the guards in `order()`. Any
+ * expensive step must first `request` its cost; when the budget is spent
+ * the request is refused, counted as deferred, and the guard keeps its
+ * previous result until a later frame. Guards that keep getting deferred
+ * age towards the front so nobody starves.
+ */
+class GuardScheduler {
+private:
+    /** Work units available per frame */
+    int _budget;
+    /** Work units spent so far this frame */
+    int _spent;
+    /** Requests refused so far this frame */
+    int _deferred;
+    /** Requests refused in the last completed frame */
+    int _deferredLastFrame;
+    /** Work units spent in the last completed frame */
+    int _spentLastFrame;
+    /** Largest number of refused requests seen in a single frame */
+    int _deferredPeak;
+    /** Total refused requests since the last reset */
+    long _deferredTotal;
+    /** Number of completed frames since the last reset */
+    long _frames;
+
+    /** (priority, guard index) pairs registered this frame */
+    std::vector<std::pair<float, int>> _queue;
+    /** Guard indices in the order they should think this frame */
+    std::vector<int> _order;
+    /** Frames each guard has been refused budget in a row */
+    std::vector<int> _starved;
+    /** The guard currently thinking, or -1 */
+    int _current;
+    /** Whether the current guard had a request refused this frame */
+    bool _currentDeferred;
+
+public:
+    GuardScheduler(int budget = AI_FRAME_BUDGET) {
+        _budget = budget;
+        resetStats();
+    }
+
+#pragma mark Frame Methods
+    /**
+     * Closes the previous frame's counters and clears the queue.
+     *
+     * @param guards    The number of guards in the set this frame
+     */
+    void beginFrame(int guards) {
+        endGuard();
+        if (_frames > 0 || _spent > 0 || _deferred > 0) {
+            _deferredLastFrame = _deferred;
+            _spentLastFrame = _spent;
+            _deferredPeak = std::max(_deferredPeak, _deferred);
+            _deferredTotal += _deferred;
+        }
+        _frames += 1;
+        _spent = 0;
+        _deferred = 0;
+        _queue.clear();
+        _starved.resize(guards, 0);
+    }
+
+    /**
+     * Registers a guard for this frame.
+     *
+     * @param guard     The index of the guard in its set
+     * @param distance  The distance from the guard to the player
+     * @param alert     Whether the guard is questioning or chasing
+     */
+    void prioritize(int guard, float distance, bool alert) {
+        float priority = distance - _starved[guard] * AI_AGING_PRIORITY;
+        if (alert) {
+            priority -= AI_ALERT_PRIORITY;
+        }
+        _queue.push_back(std::make_pair(priority, guard));
+    }
+
+    /** Returns the registered guards, most urgent first */
+    const std::vector<int>& order() {
+        std::stable_sort(_queue.begin(), _queue.end(),
+                         [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+            return a.first < b.first;
+        });
+        _order.clear();
+        for (auto& entry : _queue) {
+            _order.push_back(entry.second);
+        }
+        return _order;
+    }
+
+    /** Marks the guard whose work the following requests belong to */
+    void beginGuard(int guard) {
+        endGuard();
+        _current = guard;
+        _currentDeferred = false;
+    }
+
+    /**
+     * Asks for `cost` work units this frame.
+     *
+     * @return true if the work may run now, false if it must wait
+     */
+    bool request(int cost) {
+        if (_spent + cost > _budget) {
+            _deferred += 1;
+            _currentDeferred = true;
+            return false;
+        }
+        _spent += cost;
+        return true;
+    }
+
+#pragma mark Configuration
+    void setBudget(int budget) {
+        _budget = budget;
+    }
+
+    int getBudget() {
+        return _budget;
+    }
+
+#pragma mark Instrumentation
+    /** Returns the requests deferred in the last completed frame */
+    int getDeferredLastFrame() {
+        return _deferredLastFrame;
+    }
+
+    /** Returns the work units spent in the last completed frame */
+    int getSpentLastFrame() {
+        return _spentLastFrame;
+    }
+
+    /** Returns the worst single-frame deferral count since the last reset */
+    int getDeferredPeak() {
+        return _deferredPeak;
+    }
+
+    /** Returns the average number of deferred requests per frame */
+    float getDeferredAverage() {
+        return _frames == 0 ? 0.0f : (float)_deferredTotal / _frames;
+    }
+
+    /** Forgets how long guards have waited, as well as the statistics */
+    void reset() {
+        resetStats();
+        _starved.clear();
+    }
+
+    void resetStats() {
+        _spent = 0;
+        _deferred = 0;
+        _deferredLastFrame = 0;
+        _spentLastFrame = 0;
+        _deferredPeak = 0;
+        _deferredTotal = 0;
+        _frames = 0;
+        _current = -1;
+        _currentDeferred = false;
+    }
+
+private:
+    /** Updates the starvation count of the guard that just finished */
+    void endGuard() {
+        if (_current >= 0 && _current < _starved.size()) {
+            _starved[_current] = _currentDeferred ? _starved[_current] + 1 : 0;
+        }
+        _current = -1;
+        _currentDeferred = false;
+    }
+};
+
+#endif /* __GUARD_SCHEDULER_H__ */
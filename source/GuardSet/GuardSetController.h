@@ -9,6 +9,14 @@
 #include "Guard/GuardModel.h"
 #include "Guard/GuardView.h"
 #include "Guard/GuardController.h"
+#include "GuardScheduler.h"
+#include "SoundField.h"
+#include "GuardTrace.h"
+#include "GuardCrowd.h"
+#include "PathCache.h"
+#include "NextHopTable.h"
+#include "GuardPerception.h"
+#include <SlotMap.h>
 #include <Tilemap/TilemapController.h>
 #include <ItemSet/ItemSetController.h>
 
@@ -36,8 +44,11 @@ public:
     /** Manager to process the animation actions */
     std::shared_ptr<cugl::scene2::ActionManager> _actions;
     
-    /**vector of guard IDs**/
-    vector<int> _usedIDs;
+    /** Ticker for the guard sprite animations */
+    std::shared_ptr<SpriteAnimator> _animator;
+    
+    /**handles of the guards in this set**/
+    SlotMap<GuardController*> _handles;
     
     std::shared_ptr<TilemapController> _world;
     
@@ -49,6 +60,42 @@ public:
     /** nodes to vec2 positions*/
     std::unordered_map<int, Vec2> _nodes;
     
+    /** per-frame budget for ray casts and path re-plans */
+    GuardScheduler _scheduler;
+    
+    /** noise spread over this world's nav graph */
+    SoundField _sound;
+    
+    /** keeps guards from stacking during chases */
+    GuardCrowd _crowd;
+    
+    /** recent routes of this world's nav graph */
+    PathCache _paths;
+    
+    /** every route of a small nav graph, empty for large ones */
+    NextHopTable _hops;
+    
+    /** how often each guard looks and listens */
+    GuardPerception _perception;
+    
+    /** recent ticks of guard state and the inputs behind them */
+    GuardTrace _trace;
+    
+    /** the player's queued path, for intercepting it */
+    PlayerMotion _motion;
+    
+    /** the camera rect grown by ANIM_CULL_MARGIN, where far guards stay mid tier */
+    Rect _view;
+    /** the camera rect as last set, to trace only its changes */
+    Rect _camera;
+    bool _hasView = false;
+    
+    /** simulated seconds, so timers replay the same on any device */
+    float _clock;
+    float _lastLookaround;
+    float _questionInSPStart;
+    float _lastQuestionValue;
+    
     
 
 
@@ -56,7 +103,7 @@ public:
 #pragma mark Main Methods
 public:
     
-    GuardSetController(const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<cugl::scene2::ActionManager> actions, std::shared_ptr<TilemapController> world, std::shared_ptr<ItemSetController> items,
+    GuardSetController(const std::shared_ptr<cugl::AssetManager>& assets, std::shared_ptr<cugl::scene2::ActionManager> actions, std::shared_ptr<SpriteAnimator> animator, std::shared_ptr<TilemapController> world, std::shared_ptr<ItemSetController> items,
         bool** adjMatrix, std::unordered_map<int, Vec2> nodes)
     {
         _adjMatrix = adjMatrix;
@@ -64,6 +111,17 @@ public:
         _world = world;
         _items = items;
         _actions = actions;
+        _animator = animator;
+        _sound.init(adjMatrix, nodes);
+        _crowd.init(adjMatrix, (int)nodes.size());
+        _hops.init(adjMatrix, (int)nodes.size());
+        _clock = 0;
+        _lastLookaround = 0;
+        _questionInSPStart = 0;
+        _lastQuestionValue = 0;
+#ifdef GUARD_TRACE
+        _trace.setEnabled(true);
+#endif
         std::vector<Guard> _guardSet;
 
     };
@@ -73,13 +131,17 @@ public:
 
     // add one guard
     void add_this_moving(Vec2 gPos, std::shared_ptr<cugl::scene2::OrderedNode> s, const std::shared_ptr<cugl::AssetManager>& assets, vector<Vec2> patrol_stops, bool isPast){
-        Guard _guard = std::make_unique<GuardController>(gPos, assets, patrol_stops, _actions, generateUniqueID(), isPast);
+        SlotHandle handle = _handles.insert(nullptr);
+        Guard _guard = std::make_unique<GuardController>(gPos, assets, patrol_stops, _actions, _animator, handle, isPast);
+        *_handles.get(handle) = _guard.get();
         _guard->addChildTo(s);
         _guardSet.push_back(std::move(_guard));
     }
     
     void add_this(Vec2 gPos, std::shared_ptr<cugl::scene2::OrderedNode> s, const std::shared_ptr<cugl::AssetManager>& assets, bool isPast, int dir){
-        Guard _guard = std::make_unique<GuardController>(gPos, assets, _actions, generateUniqueID(), isPast, dir);
+        SlotHandle handle = _handles.insert(nullptr);
+        Guard _guard = std::make_unique<GuardController>(gPos, assets, _actions, _animator, handle, isPast, dir);
+        *_handles.get(handle) = _guard.get();
         _guard->addChildTo(s);
         _guardSet.push_back(std::move(_guard));
     }
@@ -107,66 +169,193 @@ public:
     }
     
     void clearSet () {
+        _crowd.releaseAll();
         _guardSet.clear();
+        _handles.clear();
+    }
+    
+    /** Returns the guard for `handle`, or nullptr if it is gone */
+    GuardController* getGuard(const SlotHandle& handle) {
+        GuardController** guard = _handles.get(handle);
+        return guard == nullptr ? nullptr : *guard;
+    }
+    
+    GuardScheduler& getScheduler() {
+        return _scheduler;
+    }
+    
+    SoundField& getSoundField() {
+        return _sound;
+    }
+    
+    PathCache& getPathCache() {
+        return _paths;
     }
     
+    GuardPerception& getPerception() {
+        return _perception;
+    }
+    
+    /**
+     * Loads the next-hop table of this world, baking and storing it first if
+     * there is none for this graph yet. Large maps are left to search.
+     *
+     * @param path  Where the table of this level and world is stored
+     */
+    void prepareNextHops(const std::string& path) {
+        if (!NextHopTable::suits((int)_nodes.size()) || _hops.load(path)) {
+            return;
+        }
+        _hops.bake();
+        if (!_hops.save(path)) {
+            CULog("could not store next-hop table at %s", path.c_str());
+        }
+    }
+    
+    GuardTrace& getTrace() {
+        return _trace;
+    }
+    
+    /**
+     * Updates the path the player is walking. Only the waypoints a guard
+     * could use are kept, and the trace only sees it when it changes.
+     *
+     * @param waypoints The positions still ahead of the player, in order
+     * @param legTime   Seconds the player takes from one waypoint to the next
+     */
+    void setPlayerMotion(const vector<Vec2>& waypoints, float legTime) {
+        PlayerMotion motion(waypoints, legTime);
+        if (motion == _motion) {
+            return;
+        }
+        // the player consumes the path from the front and the drag extends
+        // it at the back, so trace only the waypoints dropped and added
+        const vector<Vec2>& before = _motion.getWaypoints();
+        const vector<Vec2>& after = motion.getWaypoints();
+        size_t dropped = 0;
+        while (dropped < before.size() &&
+               !(before.size() - dropped <= after.size() && std::equal(before.begin() + dropped, before.end(), after.begin()))) {
+            dropped += 1;
+        }
+        size_t kept = before.size() - dropped;
+        _trace.input(GUARD_INPUT_MOTION, legTime, Vec2((float)dropped, 0), (float)(after.size() - kept));
+        for (size_t k = kept; k < after.size(); k++) {
+            _trace.input(GUARD_INPUT_WAYPOINT, 0, after[k]);
+        }
+        _motion = motion;
+    }
 
-    int generateUniqueID() {
-        int id = 0;
-        bool isUsed = true;
-        while (isUsed){
-            id = rand() % 900 + 100;
-            if (std::find(_usedIDs.begin(), _usedIDs.end(), id) != _usedIDs.end()) {
-                    id = rand() % 900 + 100;
-                }
-                else {
-                    _usedIDs.push_back(id);
-                    isUsed = false;
-                }
+    /**
+     * Sets the part of the world the camera shows. Far guards near it keep
+     * perceiving at the mid tier. The camera is not part of the guard
+     * simulation, so its changes are traced.
+     *
+     * @param camera    The world rect the active camera shows
+     */
+    void setView(const Rect& camera) {
+        if (_hasView && camera.origin == _camera.origin &&
+            camera.size.width == _camera.size.width && camera.size.height == _camera.size.height) {
+            return;
         }
+        _trace.input(GUARD_INPUT_VIEW, camera.size.width, camera.origin, camera.size.height);
+        _camera = camera;
+        _view = Rect(camera.origin.x - ANIM_CULL_MARGIN, camera.origin.y - ANIM_CULL_MARGIN,
+                     camera.size.width + 2 * ANIM_CULL_MARGIN, camera.size.height + 2 * ANIM_CULL_MARGIN);
+        _hasView = true;
+    }
 
-        return id;
+    /** Returns whether a position is close enough to the camera to count as on screen */
+    bool inView(const Vec2& pos) const {
+        return !_hasView || _view.contains(pos);
+    }
+    
+    /**
+     * Makes a noise that spreads along this world's nav graph.
+     *
+     * @param pos       Where the noise happened
+     * @param loudness  How far along the graph it carries
+     */
+    void makeNoise(Vec2 pos, float loudness) {
+        _trace.input(GUARD_INPUT_NOISE, loudness, pos);
+        _sound.emit(_world->nodeAt(pos), loudness);
     }
     
-    void patrol(Vec2 _charPos, float char_angle, shared_ptr<cugl::Scene2> scene, string world){
 
-       // static auto last_time_question = std::chrono::steady_clock::now();
-        static auto last_time_lookaround = std::chrono::steady_clock::now();
-        static auto start_question_inSP = std::chrono::steady_clock::now();
-        static auto last_time_question_value = std::chrono::steady_clock::now();
-        // Calculate the time elapsed since the last call to pinch
-        auto now = std::chrono::steady_clock::now();
-        // auto elapsed_question = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_time_question);
-        auto elapsed_lookaround = std::chrono::duration_cast<std::chrono::seconds>(now - last_time_lookaround);
-        auto elapsed_question_inSP = std::chrono::duration_cast<std::chrono::seconds>(now - start_question_inSP);
-        auto elapsed_question_value = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_time_question_value);
+    void patrol(float dt, Vec2 _charPos, float char_angle, shared_ptr<cugl::Scene2> scene){
+
+        _trace.input(GUARD_INPUT_PATROL, dt, _charPos, char_angle);
+        // timers run on simulated time, whole seconds and milliseconds as before
+        _clock += dt;
+        float now = _clock;
+        int elapsed_lookaround = (int)(now - _lastLookaround);
+        int elapsed_question_inSP = (int)(now - _questionInSPStart);
+        int elapsed_question_value = (int)((now - _lastQuestionValue) * 1000);
+        _sound.update(dt);
 
+        // guards near the player or already alerted think first
+        _scheduler.beginFrame(_guardSet.size());
+        vector<Vec2> positions(_guardSet.size());
         for (int i = 0; i < _guardSet.size(); i++){
+            positions[i] = _guardSet[i]->getNodePosition();
+            bool alert = _guardSet[i]->state == "question" || _guardSet[i]->state == "chaseD" || _guardSet[i]->state == "chaseSP";
+            _scheduler.prioritize(i, _guardSet[i]->getNodePosition().distance(_charPos), alert);
+        }
+        const vector<int>& order = _scheduler.order();
+        _crowd.rebuild(positions);
+        _perception.beginTick();
 
-            string id = std::to_string(_guardSet[i]->id);
+        for (int k = 0; k < order.size(); k++){
+            int i = order[k];
+            _scheduler.beginGuard(i);
 
-            string chaseDAction = "chaseD" + id + world;
-            string chaseSPAction = "chaseSP" + id + world;
-            string patrolAction = "patrol" + id + world;
-            string returnAction = "return" + id + world;
+            const string& chaseDAction = _guardSet[i]->getChaseDAction();
+            const string& chaseSPAction = _guardSet[i]->getChaseSPAction();
+            const string& returnAction = _guardSet[i]->getReturnAction();
 
+            if (_guardSet[i]->state != "chaseSP") {
+                // only shortest path chasers hold nodes
+                _crowd.release(i);
+            }
 
             Vec2 guardPos = _guardSet[i]->getNodePosition();
             float distance = guardPos.distance(_charPos);
-            int charDirection = calculateMappedAngle(guardPos.x, guardPos.y, _charPos.x, _charPos.y);
-            int guardFacingDirection = _guardSet[i]->getDirection();
+            bool alert = _guardSet[i]->state == "question" || _guardSet[i]->state == "chaseD" || _guardSet[i]->state == "chaseSP";
+            int tier = _perception.tier(distance, inView(guardPos), alert);
+            bool perceive = _perception.perceives(i, tier);
+
             bool insideVisionCone = false;
-            if ((guardFacingDirection + 8 -2) %8 == charDirection ||(guardFacingDirection + 8 -1) %8 == charDirection ||  (guardFacingDirection + 8 +2) %8 == charDirection ||(guardFacingDirection + 8 + 1) % 8 == charDirection || guardFacingDirection == charDirection) {
-                insideVisionCone = true;
+            if (perceive) {
+                int charDirection = calculateMappedAngle(guardPos.x, guardPos.y, _charPos.x, _charPos.y);
+                int guardFacingDirection = _guardSet[i]->getDirection();
+                if ((guardFacingDirection + 8 -2) %8 == charDirection ||(guardFacingDirection + 8 -1) %8 == charDirection ||  (guardFacingDirection + 8 +2) %8 == charDirection ||(guardFacingDirection + 8 + 1) % 8 == charDirection || guardFacingDirection == charDirection) {
+                    insideVisionCone = true;
+                }
             }
             bool visual_detection = false;
-            if (distance < 300 and _world->isActive() and insideVisionCone){
+            bool deferred = false;
+            if (!perceive) {
+                // not looked at this tick, keep what the guard saw last
+                visual_detection = _guardSet[i]->getLastVisual();
+            }
+            else if (distance < 300 and _world->isActive() and insideVisionCone){
                 // visual_detection = !_world->lineInObstacle(guardPos,_charPos);
-                visual_detection = !_items->lineInObstacle(guardPos, _charPos);
+                if (_scheduler.request(AI_COST_RAY)) {
+                    visual_detection = !_items->lineInObstacle(guardPos, _charPos);
+                    _guardSet[i]->setLastVisual(visual_detection);
+                }
+                else {
+                    // out of budget, trust what the guard saw last time
+                    visual_detection = _guardSet[i]->getLastVisual();
+                    deferred = true;
+                }
+            }
+            else {
+                _guardSet[i]->setLastVisual(false);
             }
 
+            // noise reaches the guard along the nav graph, not through walls
             bool acoustic_detection = false;
-            if (distance < 150 and _world->isActive()) {
+            if (perceive and _world->isActive() and _sound.audible(_world->nodeAt(guardPos))) {
                 acoustic_detection = true;
             }
 
@@ -183,7 +372,7 @@ public:
 
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
                     _guardSet[i]->updateState("question");
-                    last_time_question_value = now;
+                    _lastQuestionValue = now;
                     _guardSet[i]->setQuestionValue(0);
                     _guardSet[i]->setStateBeforeQuestion("static");
                 }
@@ -212,27 +401,31 @@ public:
                 // chose one rate
                 if (visual_detection) {
                     // one second if it sees
-                    current_question_value = current_question_value + (elapsed_question_value.count() * 2);
+                    current_question_value = current_question_value + (elapsed_question_value * 2);
                 } else if (acoustic_detection) {
                     // three seconds if it hears
-                    current_question_value = current_question_value + (elapsed_question_value.count() * 1.6);
+                    current_question_value = current_question_value + (elapsed_question_value * 1.6);
                 } else {
                     // three seconds if nothing happen
-                    current_question_value = current_question_value - elapsed_question_value.count();
+                    current_question_value = current_question_value - elapsed_question_value;
                 }
-                last_time_question_value = now;
+                _lastQuestionValue = now;
                 _guardSet[i]->setQuestionValue(current_question_value);
 
                 if (current_question_value > 3000 && visual_detection) {
                     // chase immediately
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
-                    _guardSet[i]->stopQuestionAnim(id);
+                    _guardSet[i]->stopQuestionAnim();
                     _guardSet[i]->updateState("chaseD");
                 }
+                else if (current_question_value > 3000 && acoustic_detection && !_scheduler.request(AI_COST_REPLAN)) {
+                    // no budget for the search this frame, keep question and retry
+                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
+                }
                 else if (current_question_value > 3000 && acoustic_detection) {
                     // chase in shortest path
               //      CULog("switch to chaseSP from question");
-                    _guardSet[i]->stopQuestionAnim(id);
+                    _guardSet[i]->stopQuestionAnim();
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
 
                     int start = findClosestNode(_guardSet[i]->getNodePosition());
@@ -240,7 +433,7 @@ public:
 
 //                    CULog("start: %d", start);
 //                    CULog("finish : %d", finish);
-                    vector<Vec2> sp =  shortestPath(start, finish);
+                    vector<Vec2> sp =  chasePath(i, start, finish);
                     _guardSet[i]->setChaseVec(sp);
                     _guardSet[i]->eraseChaseSPVec();
 //                    CULog("chase SP shortest path cycle");
@@ -263,7 +456,7 @@ public:
         //            CULog( " state before question: %s", _guardSet[i]->getStateBeforeQuestion().c_str());
                     _guardSet[i]->updateState(_guardSet[i]->getStateBeforeQuestion());
                     if (_guardSet[i]->getStateBeforeQuestion() == "question") {
-                        last_time_question_value = now;
+                        _lastQuestionValue = now;
                         _guardSet[i]->setQuestionValue(0);
                     }
 
@@ -276,7 +469,7 @@ public:
                 if (!visual_detection){
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
                     _guardSet[i]->updateState("lookaround");
-                    last_time_lookaround = now;
+                    _lastLookaround = now;
                 }
                 else{
                     //keep chasing otherwise
@@ -295,7 +488,7 @@ public:
                 else if (_guardSet[i]->chaseVec.size() == 0 ){
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
                     _guardSet[i]->updateState("lookaround");
-                    last_time_lookaround = now;
+                    _lastLookaround = now;
                     _guardSet[i]->setIfQuestionInSP(false);
                 }
 
@@ -304,17 +497,20 @@ public:
                     if (_guardSet[i]->getIfQuestionInSP() == false) {
                         CULog("start question while chaseSP");
                         _guardSet[i]->setIfQuestionInSP(true);
-                        start_question_inSP = now;
+                        _questionInSPStart = now;
                     }
                     else{
-                        if (elapsed_question_inSP.count() <= 2) {
+                        if (elapsed_question_inSP <= 2) {
                             // continue
                         }
+                        else if (!_scheduler.request(AI_COST_REPLAN)) {
+                            // no budget for the search this frame, keep the old path
+                        }
                         else {
             //                CULog("recalculate chaseSP");
                             Vec2 pos = _guardSet[i]->getNodePosition();
                             _actions->remove(chaseSPAction);
-                            _actions->remove("guard_animation");
+                            _guardSet[i]->stopAnimation();
                             _guardSet[i]->updatePosition(pos);
 
                             int start = findClosestNode(_guardSet[i]->getNodePosition());
@@ -322,7 +518,7 @@ public:
 
 //                            CULog("start: %d", start);
 //                            CULog("finish : %d", finish);
-                            vector<Vec2> sp =  shortestPath(start, finish);
+                            vector<Vec2> sp =  chasePath(i, start, finish);
                             _guardSet[i]->setChaseVec(sp);
                             _guardSet[i]->eraseChaseSPVec();
 
@@ -350,38 +546,21 @@ public:
 
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
                     _guardSet[i]->updateState("question");
-                    last_time_question_value = now;
+                    _lastQuestionValue = now;
                     _guardSet[i]->setQuestionValue(0);
                     _guardSet[i]->setStateBeforeQuestion("lookaround");
                 }
 
-                else if (elapsed_lookaround.count() <= 2){
+                else if (elapsed_lookaround <= 2){
                     // keep lookaround
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
                 }
-                else if (elapsed_lookaround.count() > 2) {
-                    int start = findClosestNode(_guardSet[i]->getNodePosition());
-                    int finish;
-                    Vec2 true_point;
-                    if (!_guardSet[i]->doesPatrol){
-                        true_point = _guardSet[i]->getStaticPosition();
-                        finish = findClosestNode(_guardSet[i]->getStaticPosition());
-                    }else {
-                        true_point = _guardSet[i]->getSavedStop();
-                        finish = findClosestNode(_guardSet[i]->getSavedStop());
-                    }
-
-                    vector<Vec2> sp = shortestPath(start, finish);
-
-                    if (sp.size() > 1) {
-                        sp.erase(sp.begin());
-                    }
-
-                     sp.pop_back();
-                     sp.push_back(true_point);
-
-
-                    _guardSet[i]->setReturnVec(sp);
+                else if (!_scheduler.request(AI_COST_REPLAN)) {
+                    // no budget for the return search this frame, keep looking around
+                    _guardSet[i]->updatePrevState(_guardSet[i]->state);
+                }
+                else if (elapsed_lookaround > 2) {
+                    _guardSet[i]->setReturnVec(returnPath(i));
 
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
                     _guardSet[i]->updateState("return");
@@ -399,11 +578,7 @@ public:
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
                     _guardSet[i]->updateState("question");
 
-                    Vec2 pos =  _guardSet[i]->getNodePosition();
-                    _actions->remove(patrolAction);
-                    _guardSet[i]->updatePosition(pos);
-
-                    last_time_question_value = now;
+                    _lastQuestionValue = now;
                     _guardSet[i]->setQuestionValue(0);
                     _guardSet[i]->setStateBeforeQuestion("patrol");
                     _guardSet[i]->saveCurrentStop();
@@ -442,7 +617,7 @@ public:
 
                     _guardSet[i]->updatePrevState(_guardSet[i]->state);
                     _guardSet[i]->updateState("question");
-                    last_time_question_value = now;
+                    _lastQuestionValue = now;
                     _guardSet[i]->setQuestionValue(0);
 
                     Vec2 pos = _guardSet[i]->getNodePosition();
@@ -486,42 +661,38 @@ public:
                 }
             }
 
-            auto elapsed_lookaround = std::chrono::duration_cast<std::chrono::seconds>(now - last_time_lookaround);
-            auto elapsed_question_inSP = std::chrono::duration_cast<std::chrono::seconds>(now - start_question_inSP);
-
 #pragma mark Guard action according to state
 
+            // effects of guards far off camera pause until they come back
+            _guardSet[i]->updateOnScreen();
 
 
             if (_guardSet[i]->state == "static") {
                 Vec2 pos = _guardSet[i]->getNodePosition();
-                _actions->remove(patrolAction);
                 _actions->remove(chaseSPAction);
                 _actions->remove(chaseDAction);
                 _guardSet[i]->updatePosition(pos);
-                _guardSet[i]->stopQuestionAnim(id);
-                _guardSet[i]->staticGuardAnim(id);
+                _guardSet[i]->stopQuestionAnim();
+                _guardSet[i]->staticGuardAnim();
 
                 _guardSet[i]->stop_exclamation();
 
             }
             else if (_guardSet[i]->state == "question") {
                 Vec2 pos = _guardSet[i]->getNodePosition();
-                _actions->remove(patrolAction);
                 _actions->remove(chaseSPAction);
                 _actions->remove(chaseDAction);
                 _guardSet[i]->updatePosition(pos);
-                _guardSet[i]->questionAnim(id, _guardSet[i]->getQuestionValue());
+                _guardSet[i]->questionAnim(_guardSet[i]->getQuestionValue());
                 _guardSet[i]->stop_exclamation();
 
             }
             else if (_guardSet[i]->state == "lookaround") {
                 Vec2 pos = _guardSet[i]->getNodePosition();
-                _actions->remove(patrolAction);
                 _actions->remove(chaseSPAction);
                 _actions->remove(chaseDAction);
                 _guardSet[i]->updatePosition(pos);
-                _guardSet[i]->lookAroundAnim(id);
+                _guardSet[i]->lookAroundAnim();
                 _guardSet[i]->stop_exclamation();
 
             }
@@ -541,71 +712,85 @@ public:
                     _guardSet[i]->eraseReturnVec();
                 }
 
-                _guardSet[i]->returnGuardAnim(id);
+                _guardSet[i]->returnGuardAnim();
                 _guardSet[i]->stop_exclamation();
 
             }
             //patrol state
             else if (_guardSet[i]->state == "patrol" and _guardSet[i]->doesPatrol){
 
-                if(_actions->isActive(patrolAction)){
-                    // guard is moving properly, wait till finished
-                    _guardSet[i]->updatePosition(_guardSet[i]->getNodePosition());
-                }
-                else{
-                    // guard is done moving, set next stop
-                    _guardSet[i]->nextStop(patrolAction);
-
-                }
-                _guardSet[i]->patrolGuardAnim(id);
+                // position comes straight from the patrol timeline
+                _guardSet[i]->advancePatrol(dt);
+                _guardSet[i]->patrolGuardAnim();
                 _guardSet[i]->stop_exclamation();
 
             }
 
 
 
-            //detection for active guard
-            else if (_guardSet[i]->state == "chaseD" and _actions->isActive(patrolAction)){
-                Vec2 pos = _guardSet[i]->getNodePosition();
-                _guardSet[i]->saveCurrentStop();
-                _actions->remove(patrolAction);
-
-                _guardSet[i]->updatePosition(pos);
-                _guardSet[i]->start_exclamation();
-            }
-            //detection for static guard
+            //detection for any guard
             else if (_guardSet[i]->state == "chaseD"){
-                if (_actions->isActive(chaseDAction)) {
-                    // wait for it to finish
+                GuardPursuit& pursuit = _guardSet[i]->getPursuit();
+                if (_actions->isActive(chaseDAction) && pursuit.error(_charPos, now) <= PURSUIT_ERROR) {
+                    // the player is where the move expected, let it run
                 }
                 else {
-                    _guardSet[i]->updateChaseSpeed(5);
                     Vec2 pos = _guardSet[i]->getNodePosition();
 
-                    _actions->remove(chaseSPAction);
-                    _actions->remove(chaseDAction);
-                    _guardSet[i]->updatePosition(pos);
+                    // head for where the player will be, not where it is
+                    Vec2 target = pursuit.plan(pos, _guardSet[i]->getChaseSpeed(), _charPos, _motion, now);
+                    // and keep clear of the other chasers
+                    target += _crowd.separation(i);
+                    // never through an obstacle: stop short of it, or step
+                    // straight at the player as before when that is clear
+                    bool limited = false;
+                    float reach = std::min(PURSUIT_MIN_MOVE, pos.distance(_charPos));
+                    target = clearMove(pos, target, limited);
+                    if (pos.distance(target) < reach && !limited) {
+                        float step = std::min(50.0f, pos.distance(_charPos));
+                        target = clearMove(pos, pos + (_charPos - pos).getNormalization() * step, limited);
+                    }
 
-                    Vec2 target = guardPos + ((_charPos - guardPos)/distance)*50;
-                    // chase
-                    _guardSet[i]->updateChaseTarget(target);
-                    _guardSet[i]->chaseChar(chaseDAction);
+                    if (pos.distance(target) >= reach && pos.distance(target) > 0) {
+                        _actions->remove(chaseSPAction);
+                        _actions->remove(chaseDAction);
+                        _guardSet[i]->updatePosition(pos);
+                        // 5 faster for every 50px chased, up to the usual cap
+                        _guardSet[i]->updateChaseSpeed(5 * std::max(1, (int)(pos.distance(target) / 50)));
+                        _guardSet[i]->updateChaseTarget(target);
+                        _guardSet[i]->chaseChar(chaseDAction);
+                    }
+                    else if (limited || reach < PURSUIT_MIN_MOVE) {
+                        // out of rays this frame, or already on the player;
+                        // the last move keeps running if it is
+                    }
+                    else if (_scheduler.request(AI_COST_REPLAN)) {
+                        // boxed in by an obstacle, go around it on the nav graph
+                        _actions->remove(chaseDAction);
+                        _guardSet[i]->updatePosition(pos);
+                        _guardSet[i]->setChaseVec(chasePath(i, findClosestNode(pos), findClosestNode(_charPos)));
+                        if (!_guardSet[i]->chaseVec.empty()) {
+                            _guardSet[i]->eraseChaseSPVec();
+                        }
+                        _guardSet[i]->updatePrevState(_guardSet[i]->state);
+                        _guardSet[i]->updateState("chaseSP");
+                    }
                 }
-                _guardSet[i]->chaseGuardAnim(id);
+                _guardSet[i]->chaseGuardAnim();
                 _guardSet[i]->start_exclamation();
             }
             else if (_guardSet[i]->state == "chaseSP"){
                 if (_actions->isActive(chaseSPAction)) {
                     // wait for it to finish
             //        CULog("in the process of chase SP");
-                    _guardSet[i]->chaseGuardAnim(id);
+                    _guardSet[i]->chaseGuardAnim();
                 }
 
                 else {
                     _guardSet[i]->updateChaseSpeed(5);
                     _guardSet[i]->updateChaseSPTarget(_guardSet[i]->chaseVec[0]);
                     _guardSet[i]->chaseChar(chaseSPAction);
-                    _guardSet[i]->chaseGuardAnim(id);
+                    _guardSet[i]->chaseGuardAnim();
              //       CULog("start chasing from %f  %f to %f  %f ", _guardSet[i]->getNodePosition().x, _guardSet[i]->getNodePosition().y,_guardSet[i]->chaseVec[0].x, _guardSet[i]->chaseVec[0].y );
                     // erase from return vector
                     _guardSet[i]->eraseChaseSPVec();
@@ -617,26 +802,309 @@ public:
             Vec2 pos = _guardSet[i]->getNodePosition();
             _guardSet[i]->updatePosition(pos);
 
-            
+            uint8_t detection = (visual_detection ? GUARD_TRACE_SAW : 0) | (acoustic_detection ? GUARD_TRACE_HEARD : 0) |
+                (insideVisionCone ? GUARD_TRACE_IN_CONE : 0) | (deferred ? GUARD_TRACE_DEFERRED : 0);
+            traceGuard(i, detection);
         }
+        _trace.endTick();
     }
     
-    int findClosestNode(Vec2 pos){
-     //   CULog("original postion: %f  %f", pos.x, pos.y);
-        int closest = 0;
-        int minDistance = 100000000;
-        for (int i = 0; i < _nodes.size(); i++){
-            int dis = pos.distance(_nodes[i]);
-            if (dis < minDistance){
-                minDistance = dis;
-                closest = i;
+#pragma mark Trace Methods
+    /** Appends guard `i` as it is after this tick to the trace */
+    void traceGuard(int i, uint8_t detection){
+        if (!_trace.isEnabled()) {
+            return;
+        }
+        const SlotHandle& handle = _guardSet[i]->handle;
+        Vec2 pos = _guardSet[i]->getNodePosition();
+        GuardTraceRecord record;
+        record.tick = 0;
+        record.index = (uint16_t)handle.index;
+        record.generation = (uint16_t)handle.generation;
+        record.x = pos.x;
+        record.y = pos.y;
+        record.question = (int16_t)std::max(-32768, std::min(32767, _guardSet[i]->getQuestionValue()));
+        record.chaseLength = (uint16_t)_guardSet[i]->chaseVec.size();
+        record.returnLength = (uint16_t)_guardSet[i]->returnVec.size();
+        record.state = GuardTrace::stateCode(_guardSet[i]->state);
+        record.detection = detection;
+        _trace.record(record);
+    }
+    
+    /**
+     * Restarts the trace and the simulated clock. Called once the level is
+     * set up, so a replay starts from the same state as the recording.
+     */
+    void startTrace(){
+        _trace.clear();
+        // everything a tick reads starts over, as in a freshly built set
+        _perception.reset();
+        _sound.reset();
+        _scheduler.reset();
+        _motion = PlayerMotion();
+        _hasView = false;
+        _clock = 0;
+        _lastLookaround = 0;
+        _questionInSPStart = 0;
+        _lastQuestionValue = 0;
+    }
+    
+    /**
+     * Feeds the inputs of `recorded` through this set, which must be freshly
+     * set up for the same level, and diffs the result against the recording.
+     * Actions are stepped as the game loop would and the world is switched
+     * on and off with the recorded sleeps and wakes; nothing is drawn.
+     *
+     * @return the index of the first differing record, or -1 if they match
+     */
+    long replay(const GuardTrace& recorded){
+        if (!recorded.isComplete()) {
+            CULog("guard trace lost its first ticks and cannot be replayed");
+            return 0;
+        }
+        bool enabled = _trace.isEnabled();
+        // the game flips the world with every sleep and wake; the recording
+        // starts awake if its first tick patrolled
+        bool active = _world->isActive();
+        for (size_t k = 0; k < recorded.inputCount(); k++) {
+            uint8_t kind = recorded.inputAt(k).kind;
+            if (kind == GUARD_INPUT_PATROL || kind == GUARD_INPUT_INACTIVE) {
+                _world->setActive(kind == GUARD_INPUT_PATROL);
+                break;
+            }
+        }
+        startTrace();
+        _trace.setEnabled(true);
+        for (size_t k = 0; k < recorded.inputCount(); k++) {
+            const GuardInputRecord& in = recorded.inputAt(k);
+            Vec2 pos(in.x, in.y);
+            switch (in.kind) {
+                case GUARD_INPUT_PATROL:
+                    patrol(in.dt, pos, in.angle, nullptr);
+                    _actions->update(in.dt);
+                    break;
+                case GUARD_INPUT_INACTIVE:
+                    updateInactive(in.dt, false);
+                    _actions->update(in.dt);
+                    break;
+                case GUARD_INPUT_NOISE:
+                    makeNoise(pos, in.dt);
+                    break;
+                case GUARD_INPUT_SLEEP:
+                    _world->setActive(false);
+                    sleep();
+                    break;
+                case GUARD_INPUT_WAKE:
+                    _world->setActive(true);
+                    wake();
+                    break;
+                case GUARD_INPUT_MOTION: {
+                    vector<Vec2> waypoints = _motion.getWaypoints();
+                    waypoints.erase(waypoints.begin(), waypoints.begin() + std::min(waypoints.size(), (size_t)in.x));
+                    for (int w = 0; w < (int)in.angle && k + 1 < recorded.inputCount(); w++) {
+                        k += 1;
+                        waypoints.push_back(Vec2(recorded.inputAt(k).x, recorded.inputAt(k).y));
+                    }
+                    setPlayerMotion(waypoints, in.dt);
+                    break;
+                }
+                case GUARD_INPUT_VIEW:
+                    setView(Rect(pos, Size(in.dt, in.angle)));
+                    break;
             }
         }
-        return closest;
+        long result = GuardTrace::diff(recorded, _trace);
+        CULog("guard replay of %zu inputs: %s", recorded.inputCount(), result < 0 ? "matches" : "diverged");
+        _trace.setEnabled(enabled);
+        _world->setActive(active);
+        return result;
+    }
+    
+    /** Returns the path from guard `i` back to its post or saved patrol stop */
+    vector<Vec2> returnPath(int i){
+        int start = findClosestNode(_guardSet[i]->getNodePosition());
+        int finish;
+        Vec2 true_point;
+        if (!_guardSet[i]->doesPatrol){
+            true_point = _guardSet[i]->getStaticPosition();
+            finish = findClosestNode(_guardSet[i]->getStaticPosition());
+        }else {
+            true_point = _guardSet[i]->getSavedStop();
+            finish = findClosestNode(_guardSet[i]->getSavedStop());
+        }
+
+        vector<Vec2> sp = shortestPath(start, finish);
+
+        if (sp.size() > 1) {
+            sp.erase(sp.begin());
+        }
+
+        sp.pop_back();
+        sp.push_back(true_point);
+        return sp;
+    }
+
+#pragma mark Restart Methods
+    /**
+     * Restarts the level for this set without rebuilding it. Every guard
+     * keeps its handle, controller and nodes; only its state is reset.
+     */
+    void reset(){
+        for (auto& guard : _guardSet){
+            _actions->remove(guard->getReturnAction());
+            _actions->remove(guard->getChaseDAction());
+            _actions->remove(guard->getChaseSPAction());
+            guard->reset();
+        }
+        _crowd.releaseAll();
+        startTrace();
+    }
+
+#pragma mark Inactive World Methods
+    /**
+     * Parks the set while the player is in the other world.
+     *
+     * Running actions are dropped and any guard that is questioning, chasing
+     * or looking around heads straight home, since nobody can be perceived in
+     * a hidden world anyway. Afterwards the set is advanced with
+     * `updateInactive` instead of `patrol` until `wake` is called.
+     */
+    void sleep(){
+        _trace.input(GUARD_INPUT_SLEEP, 0, Vec2::ZERO);
+        _crowd.releaseAll();
+        for (int i = 0; i < _guardSet.size(); i++){
+            const string& returnAction = _guardSet[i]->getReturnAction();
+
+            if (_actions->isActive(returnAction)) {
+                // the leg in flight was already taken off the return vector
+                _guardSet[i]->prependReturnVec(_guardSet[i]->getReturnTarget());
+            }
+            _actions->remove(returnAction);
+            _actions->remove(_guardSet[i]->getChaseDAction());
+            _actions->remove(_guardSet[i]->getChaseSPAction());
+            _guardSet[i]->stopAnimation();
+            _guardSet[i]->updatePosition(_guardSet[i]->getNodePosition());
+
+            string s = _guardSet[i]->state;
+            if (s == "question" || s == "chaseD" || s == "chaseSP" || s == "lookaround") {
+                _guardSet[i]->setReturnVec(returnPath(i));
+                _guardSet[i]->setQuestionValue(0);
+                _guardSet[i]->setIfQuestionInSP(false);
+                _guardSet[i]->setLastVisual(false);
+                _guardSet[i]->updatePrevState(s);
+                _guardSet[i]->updateState("return");
+            }
+            _guardSet[i]->stopQuestionAnim();
+            _guardSet[i]->stop_exclamation();
+            _guardSet[i]->sleep();
+        }
+    }
+
+    /** Rebuilds the views of a parked set so `patrol` can take over again */
+    void wake(){
+        _trace.input(GUARD_INPUT_WAKE, 0, Vec2::ZERO);
+        for (auto& guard : _guardSet){
+            guard->wake();
+        }
+    }
+
+    /**
+     * Advances a parked set: patrol progress only, no perception, no actions
+     * and no animation.
+     *
+     * @param dt        The amount of time since the last update
+     * @param visible   Whether the world is shown through the preview lens
+     */
+    void updateInactive(float dt, bool visible){
+        _trace.input(GUARD_INPUT_INACTIVE, dt, Vec2::ZERO);
+        _clock += dt;
+        _sound.update(dt);
+        for (auto& guard : _guardSet){
+            guard->updateInactive(dt);
+            if (visible) {
+                guard->syncView();
+            }
+        }
+        _trace.endTick();
+    }
+
+    int findClosestNode(Vec2 pos){
+     //   CULog("original postion: %f  %f", pos.x, pos.y);
+        // the nav nodes are a regular grid, so this is a direct lookup
+        return _world->nodeAt(pos);
     }
     
     
+    /**
+     * Returns the farthest point of the straight move from `from` to `to`
+     * that no obstacle blocks, `to` itself when the whole move is clear.
+     * Every ray is charged to the scheduler; once one is refused, `limited`
+     * is set and the clear part found so far is returned.
+     */
+    Vec2 clearMove(Vec2 from, Vec2 to, bool& limited){
+        if (!_scheduler.request(AI_COST_RAY)) {
+            limited = true;
+            return from;
+        }
+        if (!_items->lineInObstacle(from, to)) {
+            return to;
+        }
+        // a prefix of the move is blocked once it reaches the first obstacle
+        float clear = 0;
+        float blocked = 1;
+        for (int k = 0; k < PURSUIT_CLEAR_STEPS; k++) {
+            if (!_scheduler.request(AI_COST_RAY)) {
+                limited = true;
+                break;
+            }
+            float mid = (clear + blocked) / 2;
+            if (_items->lineInObstacle(from, from + (to - from) * mid)) {
+                blocked = mid;
+            }
+            else {
+                clear = mid;
+            }
+        }
+        return from + (to - from) * clear;
+    }
+
+    /**
+     * Returns the chase route of guard `i`, moved off nodes other chasers
+     * already hold, and reserves it.
+     */
+    vector<Vec2> chasePath(int i, int start, int end){
+        vector<int> route = _crowd.spread(i, shortestNodePath(start, end));
+        _crowd.claim(i, route);
+        vector<Vec2> path;
+        for (int node : route) {
+            path.push_back(_nodes[node]);
+        }
+        return path;
+    }
+
     vector<Vec2> shortestPath(int start, int end){
+        vector<Vec2> path;
+        for (int node : shortestNodePath(start, end)) {
+            path.push_back(_nodes[node]);
+        }
+        return path;
+    }
+
+    /** Returns the nav nodes of a shortest route from `start` to `end` */
+    vector<int> shortestNodePath(int start, int end){
+        // routes home repeat constantly, most are already known
+        const vector<int>* cached = _paths.get(start, end);
+        if (cached != nullptr) {
+            return *cached;
+        }
+
+        // small maps have every route baked
+        vector<int> route;
+        if (_hops.route(start, end, route)) {
+            _paths.put(start, end, route);
+            return route;
+        }
+
         int n = _nodes.size();
         vector<int> dist(n, 1e9);
         dist[start] = 0;
@@ -662,13 +1130,14 @@ public:
         }
 
         // backtrack from end to start to get path
-        vector<Vec2> path;
+        vector<int> path;
         int curr = end;
         while (curr != -1) {
-            path.push_back(_nodes[curr]);
+            path.push_back(curr);
             curr = parent[curr];
         }
         reverse(path.begin(), path.end());
+        _paths.put(start, end, path);
 
 
 //        CULog("inside shortest path");
@@ -730,6 +1199,13 @@ public:
         }
     }
 
+    /** Appends the sprite of every guard, for depth sorting */
+    void collectNodes(std::vector<cugl::scene2::SceneNode*>& nodes){
+        for(auto &guard : _guardSet){
+            nodes.push_back(guard->getNode());
+        }
+    }
+
 };
 
 
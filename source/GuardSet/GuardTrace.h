@@ -0,0 +1,297 @@
+//
+//  GuardTrace.h
+//  Tilemap
+//
+//  Compact binary trace of the guard simulation. Every tick writes one
+//  record per guard into a ring buffer, next to the inputs the tick saw, so
+//  a session can be dumped to a file, replayed through a freshly loaded
+//  GuardSetController and diffed against the recording.
+//
+
+#ifndef __GUARD_TRACE_H__
+#define __GUARD_TRACE_H__
+
+// #define GUARD_TRACE     // record guard traces and dump them when the player is caught
+// #define GUARD_REPLAY    // replay the dumped traces when a level loads
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+/** Ticks traced, one minute at 60 fps */
+#define GUARD_TRACE_TICKS       3600
+/**
+ * Input entries kept: the tick call, a camera move and a path update of
+ * two entries, with room to spare for noises and world switches
+ */
+#define GUARD_TRACE_INPUTS      (GUARD_TRACE_TICKS * 6)
+/** Guard records kept, enough for 16 guards over the same minute */
+#define GUARD_TRACE_RECORDS     (GUARD_TRACE_TICKS * 16)
+
+/** Detection bits of a record */
+#define GUARD_TRACE_SAW         0x01
+#define GUARD_TRACE_HEARD       0x02
+#define GUARD_TRACE_IN_CONE     0x04
+/** The vision ray was over budget and the last result was reused */
+#define GUARD_TRACE_DEFERRED    0x08
+
+/** Kinds of input entries, replayed in the order they were recorded */
+#define GUARD_INPUT_PATROL      0
+#define GUARD_INPUT_INACTIVE    1
+#define GUARD_INPUT_NOISE       2
+#define GUARD_INPUT_SLEEP       3
+#define GUARD_INPUT_WAKE        4
+/**
+ * A change of the player path: `x` waypoints are dropped from its front and
+ * the `angle` waypoint entries that follow are appended
+ */
+#define GUARD_INPUT_MOTION      5
+#define GUARD_INPUT_WAYPOINT    6
+/** The camera moved: `x`, `y` is its origin, `dt` and `angle` its size */
+#define GUARD_INPUT_VIEW        7
+
+/** One call into the guard set */
+struct GuardInputRecord {
+    uint32_t tick;
+    /** Frame time, loudness for a noise, or leg time for a motion */
+    float dt;
+    /** Character position, or where a noise happened */
+    float x;
+    float y;
+    float angle;
+    uint8_t kind;
+    uint8_t pad[3];
+};
+
+/** One guard after one patrol tick */
+struct GuardTraceRecord {
+    uint32_t tick;
+    uint16_t index;
+    uint16_t generation;
+    float x;
+    float y;
+    int16_t question;
+    uint16_t chaseLength;
+    uint16_t returnLength;
+    uint8_t state;
+    uint8_t detection;
+};
+
+/** A fixed-size buffer that overwrites its oldest entry when full */
+template <typename T>
+class TraceRing {
+private:
+    std::vector<T> _data;
+    size_t _capacity;
+    /** Entries ever pushed */
+    size_t _written;
+
+public:
+    TraceRing(size_t capacity) : _capacity(capacity), _written(0) {}
+
+    void push(const T& value) {
+        if (_data.size() < _capacity) {
+            _data.push_back(value);
+        } else {
+            _data[_written % _capacity] = value;
+        }
+        _written += 1;
+    }
+
+    size_t size() const {
+        return _data.size();
+    }
+
+    /** Returns whether old entries have been overwritten */
+    bool wrapped() const {
+        return _written > _capacity;
+    }
+
+    /** Returns entry `i`, counted from the oldest kept */
+    const T& at(size_t i) const {
+        return wrapped() ? _data[(_written + i) % _capacity] : _data[i];
+    }
+
+    void clear() {
+        _data.clear();
+        _written = 0;
+    }
+};
+
+class GuardTrace {
+private:
+    TraceRing<GuardInputRecord> _inputs;
+    TraceRing<GuardTraceRecord> _records;
+    uint32_t _tick;
+    bool _enabled;
+    /** Set when a loaded file was dumped after its start had been overwritten */
+    bool _truncated;
+
+    /** Written at the start of a dump, "GTRC" */
+    static const uint32_t MAGIC = 0x43525447;
+    static const uint32_t VERSION = 2;
+
+public:
+    GuardTrace() : _inputs(GUARD_TRACE_INPUTS), _records(GUARD_TRACE_RECORDS), _tick(0), _enabled(false), _truncated(false) {}
+
+    void setEnabled(bool enabled) {
+        _enabled = enabled;
+    }
+
+    bool isEnabled() const {
+        return _enabled;
+    }
+
+    void clear() {
+        _inputs.clear();
+        _records.clear();
+        _tick = 0;
+        _truncated = false;
+    }
+
+    uint32_t getTick() const {
+        return _tick;
+    }
+
+    /** Returns whether the inputs still reach back to tick 0, so they can be replayed */
+    bool isComplete() const {
+        return !_inputs.wrapped() && !_truncated;
+    }
+
+    size_t inputCount() const {
+        return _inputs.size();
+    }
+
+    const GuardInputRecord& inputAt(size_t i) const {
+        return _inputs.at(i);
+    }
+
+    size_t recordCount() const {
+        return _records.size();
+    }
+
+    const GuardTraceRecord& recordAt(size_t i) const {
+        return _records.at(i);
+    }
+
+    /** Returns the compact code of a guard state string */
+    static uint8_t stateCode(const std::string& state) {
+        static const char* names[] = { "static", "question", "chaseD", "chaseSP", "lookaround", "patrol", "return" };
+        for (uint8_t i = 0; i < 7; i++) {
+            if (state == names[i]) {
+                return i;
+            }
+        }
+        return UINT8_MAX;
+    }
+
+#pragma mark Recording
+    void input(uint8_t kind, float dt, cugl::Vec2 pos, float angle = 0) {
+        if (!_enabled) {
+            return;
+        }
+        GuardInputRecord entry = { _tick, dt, pos.x, pos.y, angle, kind, {0, 0, 0} };
+        _inputs.push(entry);
+    }
+
+    void record(const GuardTraceRecord& record) {
+        if (!_enabled) {
+            return;
+        }
+        GuardTraceRecord entry = record;
+        entry.tick = _tick;
+        _records.push(entry);
+    }
+
+    /** Closes the current tick; records after this belong to the next one */
+    void endTick() {
+        if (_enabled) {
+            _tick += 1;
+        }
+    }
+
+#pragma mark Files
+    /**
+     * Writes the trace to `path`: a header, the inputs and the records, each
+     * oldest first.
+     *
+     * @return whether the file could be written
+     */
+    bool dump(const std::string& path) const {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            CULog("could not write guard trace to %s", path.c_str());
+            return false;
+        }
+        uint32_t header[5] = { MAGIC, VERSION, (uint32_t)isComplete(), (uint32_t)_inputs.size(), (uint32_t)_records.size() };
+        out.write((const char*)header, sizeof(header));
+        for (size_t i = 0; i < _inputs.size(); i++) {
+            out.write((const char*)&_inputs.at(i), sizeof(GuardInputRecord));
+        }
+        for (size_t i = 0; i < _records.size(); i++) {
+            out.write((const char*)&_records.at(i), sizeof(GuardTraceRecord));
+        }
+        return (bool)out;
+    }
+
+    /**
+     * Replaces this trace with the one stored at `path`.
+     *
+     * @return whether a valid trace was read
+     */
+    bool load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        uint32_t header[5];
+        if (!in || !in.read((char*)header, sizeof(header)) || header[0] != MAGIC || header[1] != VERSION) {
+            CULog("no guard trace at %s", path.c_str());
+            return false;
+        }
+        clear();
+        GuardInputRecord entry;
+        for (uint32_t i = 0; i < header[3] && in.read((char*)&entry, sizeof(entry)); i++) {
+            _inputs.push(entry);
+        }
+        GuardTraceRecord record;
+        for (uint32_t i = 0; i < header[4] && in.read((char*)&record, sizeof(record)); i++) {
+            _records.push(record);
+            _tick = record.tick + 1;
+        }
+        _truncated = header[2] == 0;
+        return _inputs.size() == header[3] && _records.size() == header[4];
+    }
+
+    /**
+     * Compares two traces record by record and logs the first difference.
+     *
+     * @return the index of the first differing record, or -1 if they match
+     */
+    static long diff(const GuardTrace& expected, const GuardTrace& actual) {
+        size_t count = std::min(expected.recordCount(), actual.recordCount());
+        for (size_t i = 0; i < count; i++) {
+            const GuardTraceRecord& a = expected.recordAt(i);
+            const GuardTraceRecord& b = actual.recordAt(i);
+            if (a.tick != b.tick || a.index != b.index || a.generation != b.generation ||
+                a.state != b.state || a.detection != b.detection || a.question != b.question ||
+                a.chaseLength != b.chaseLength || a.returnLength != b.returnLength ||
+                std::abs(a.x - b.x) > 0.01f || std::abs(a.y - b.y) > 0.01f) {
+                CULog("guard trace diverges at tick %u, guard %u:", a.tick, a.index);
+                CULog("  expected state %u, bits %x, pos (%.2f, %.2f), question %d, paths %u/%u",
+                      a.state, a.detection, a.x, a.y, a.question, a.chaseLength, a.returnLength);
+                CULog("  replayed state %u, bits %x, pos (%.2f, %.2f), question %d, paths %u/%u",
+                      b.state, b.detection, b.x, b.y, b.question, b.chaseLength, b.returnLength);
+                return (long)i;
+            }
+        }
+        if (expected.recordCount() != actual.recordCount()) {
+            CULog("guard trace lengths differ: %zu recorded, %zu replayed", expected.recordCount(), actual.recordCount());
+            return (long)count;
+        }
+        return -1;
+    }
+};
+
+#endif /* __GUARD_TRACE_H__ */
@@ -0,0 +1,186 @@
+//
+//  NextHopTable.h
+//  Tilemap
+//
+//  All-pairs next-hop routing for small nav graphs. For every goal node the
+//  table stores, per node, which of its neighbours is one step closer, so a
+//  route is a walk of table lookups with no search. Entries are neighbour
+//  slots rather than node ids, one byte each. Maps above NEXT_HOP_MAX_NODES
+//  keep searching on demand.
+//
+
+#ifndef __NEXT_HOP_TABLE_H__
+#define __NEXT_HOP_TABLE_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <queue>
+#include <string>
+#include <fstream>
+#include <cstdint>
+
+/** Largest nav graph that gets a table, about 1MB at this size */
+#define NEXT_HOP_MAX_NODES  1000
+/** Entry for the goal itself and for nodes that cannot reach it */
+#define NEXT_HOP_NONE       0xFF
+
+class NextHopTable {
+private:
+    /** Neighbours of each nav node; entries index into these lists */
+    std::vector<std::vector<int>> _adjacency;
+    /** Row per goal, column per node: slot of the next node toward the goal */
+    std::vector<uint8_t> _hops;
+    /** Hash of the graph, so a stored table is never used for another one */
+    uint64_t _signature;
+    int _n;
+    bool _ready;
+
+    /** Written at the start of a stored table, "NHOP" */
+    static const uint32_t MAGIC = 0x504F484E;
+
+public:
+    NextHopTable() : _signature(0), _n(0), _ready(false) {}
+
+    /** Returns whether a graph of `n` nodes is small enough for a table */
+    static bool suits(int n) {
+        return n > 0 && n <= NEXT_HOP_MAX_NODES;
+    }
+
+    /**
+     * Reads the graph the table is for. The table itself is empty until
+     * `bake` or `load` succeeds.
+     *
+     * @param adjMatrix The nav graph adjacency matrix
+     * @param n         The number of nav nodes
+     */
+    void init(bool** adjMatrix, int n) {
+        _n = n;
+        _ready = false;
+        _hops.clear();
+        _adjacency.assign(n, std::vector<int>());
+        // FNV-1a over the edge list
+        _signature = 1469598103934665603ull;
+        for (int u = 0; u < n && adjMatrix != nullptr; u++) {
+            for (int v = 0; v < n; v++) {
+                if (adjMatrix[u][v]) {
+                    _adjacency[u].push_back(v);
+                    _signature = (_signature ^ (uint64_t)(u * 31 + v)) * 1099511628211ull;
+                }
+            }
+        }
+        _signature = (_signature ^ (uint64_t)n) * 1099511628211ull;
+    }
+
+    bool isReady() const {
+        return _ready;
+    }
+
+#pragma mark Bake
+    /** Fills the table with one breadth-first search per goal */
+    void bake() {
+        if (!suits(_n)) {
+            return;
+        }
+        for (auto& neighbours : _adjacency) {
+            if (neighbours.size() >= NEXT_HOP_NONE) {
+                CULog("nav node with %zu neighbours, next-hop table skipped", neighbours.size());
+                return;
+            }
+        }
+        _hops.assign((size_t)_n * _n, NEXT_HOP_NONE);
+        std::vector<bool> seen(_n);
+        std::queue<int> q;
+        for (int goal = 0; goal < _n; goal++) {
+            uint8_t* row = &_hops[(size_t)goal * _n];
+            std::fill(seen.begin(), seen.end(), false);
+            seen[goal] = true;
+            q.push(goal);
+            while (!q.empty()) {
+                int u = q.front();
+                q.pop();
+                for (int v : _adjacency[u]) {
+                    if (seen[v]) {
+                        continue;
+                    }
+                    seen[v] = true;
+                    // v reaches the goal through u
+                    const std::vector<int>& back = _adjacency[v];
+                    for (int slot = 0; slot < back.size(); slot++) {
+                        if (back[slot] == u) {
+                            row[v] = (uint8_t)slot;
+                            break;
+                        }
+                    }
+                    q.push(v);
+                }
+            }
+        }
+        _ready = true;
+    }
+
+    /** Stores the table at `path`; returns whether it was written */
+    bool save(const std::string& path) const {
+        if (!_ready) {
+            return false;
+        }
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        uint32_t header[2] = { MAGIC, (uint32_t)_n };
+        out.write((const char*)header, sizeof(header));
+        out.write((const char*)&_signature, sizeof(_signature));
+        out.write((const char*)_hops.data(), _hops.size());
+        return (bool)out;
+    }
+
+    /**
+     * Reads a table stored by `save`. Tables baked for a different graph
+     * are rejected.
+     *
+     * @return whether the table is ready to use
+     */
+    bool load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        uint32_t header[2];
+        uint64_t signature;
+        if (!in || !in.read((char*)header, sizeof(header)) || !in.read((char*)&signature, sizeof(signature))) {
+            return false;
+        }
+        if (header[0] != MAGIC || header[1] != (uint32_t)_n || signature != _signature) {
+            return false;
+        }
+        _hops.resize((size_t)_n * _n);
+        _ready = (bool)in.read((char*)_hops.data(), _hops.size());
+        return _ready;
+    }
+
+#pragma mark Queries
+    /**
+     * Writes the route from `start` to `goal` into `route`, both included.
+     * An unreachable goal gives just the goal, like the search it replaces.
+     *
+     * @return false if there is no table and the caller has to search
+     */
+    bool route(int start, int goal, std::vector<int>& route) const {
+        if (!_ready || start < 0 || goal < 0 || start >= _n || goal >= _n) {
+            return false;
+        }
+        route.clear();
+        const uint8_t* row = &_hops[(size_t)goal * _n];
+        int curr = start;
+        route.push_back(curr);
+        while (curr != goal) {
+            uint8_t slot = row[curr];
+            if (slot == NEXT_HOP_NONE) {
+                route.assign(1, goal);
+                return true;
+            }
+            curr = _adjacency[curr][slot];
+            route.push_back(curr);
+        }
+        return true;
+    }
+};
+
+#endif /* __NEXT_HOP_TABLE_H__ */
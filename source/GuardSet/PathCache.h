@@ -0,0 +1,104 @@
+//
+//  PathCache.h
+//  Tilemap
+//
+//  Least-recently-used cache of nav graph routes. Guards return to the same
+//  few posts and patrol stops over and over, so most searches after the
+//  first are answered from here. One cache belongs to one world's guard
+//  set and is dropped whenever that world's graph is rebuilt.
+//
+
+#ifndef __PATH_CACHE_H__
+#define __PATH_CACHE_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+
+/** Routes kept per world */
+#define PATH_CACHE_SIZE     64
+
+class PathCache {
+private:
+    typedef std::pair<uint64_t, std::vector<int>> Entry;
+
+    /** Most recently used first */
+    std::list<Entry> _entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> _index;
+    size_t _capacity;
+    long _hits;
+    long _misses;
+
+    static uint64_t key(int start, int goal) {
+        return ((uint64_t)(uint32_t)start << 32) | (uint32_t)goal;
+    }
+
+public:
+    PathCache(size_t capacity = PATH_CACHE_SIZE) : _capacity(capacity), _hits(0), _misses(0) {}
+
+    /**
+     * Returns the cached route from `start` to `goal`, or nullptr. The
+     * pointer is valid until the next `put` or `invalidate`.
+     */
+    const std::vector<int>* get(int start, int goal) {
+        auto it = _index.find(key(start, goal));
+        if (it == _index.end()) {
+            _misses += 1;
+            return nullptr;
+        }
+        _hits += 1;
+        _entries.splice(_entries.begin(), _entries, it->second);
+        return &it->second->second;
+    }
+
+    /** Stores a route, dropping the least recently used one if full */
+    void put(int start, int goal, const std::vector<int>& route) {
+        uint64_t k = key(start, goal);
+        auto it = _index.find(k);
+        if (it != _index.end()) {
+            it->second->second = route;
+            _entries.splice(_entries.begin(), _entries, it->second);
+            return;
+        }
+        if (_entries.size() >= _capacity) {
+            _index.erase(_entries.back().first);
+            _entries.pop_back();
+        }
+        _entries.emplace_front(k, route);
+        _index[k] = _entries.begin();
+    }
+
+    /** Drops every route, for when the nav graph changes */
+    void invalidate() {
+        _entries.clear();
+        _index.clear();
+    }
+
+#pragma mark Statistics
+    long getHits() const {
+        return _hits;
+    }
+
+    long getMisses() const {
+        return _misses;
+    }
+
+    /** Returns the fraction of lookups answered from the cache */
+    float getHitRate() const {
+        long total = _hits + _misses;
+        return total == 0 ? 0 : (float)_hits / total;
+    }
+
+    void resetStats() {
+        _hits = 0;
+        _misses = 0;
+    }
+
+    size_t size() const {
+        return _entries.size();
+    }
+};
+
+#endif /* __PATH_CACHE_H__ */
@@ -0,0 +1,179 @@
+//
+//  SoundField.h
+//  Tilemap
+//
+//  Noise spread over the guard nav graph. Each noise event runs one bounded
+//  Dijkstra from the node it happened at, so walls (missing edges) block
+//  sound and guards read their own node's loudness in O(1).
+//
+
+#ifndef __SOUND_FIELD_H__
+#define __SOUND_FIELD_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <functional>
+
+using namespace cugl;
+
+/** Loudness of one footstep, in points of nav graph distance it carries */
+#define SOUND_FOOTSTEP      150.0f
+/** Loudness of picking up an artifact or resource */
+#define SOUND_PICKUP        250.0f
+/** Loudness of arriving in a world after a switch */
+#define SOUND_SWITCH        300.0f
+/** Seconds between two footstep events while the character walks */
+#define SOUND_STEP_INTERVAL 0.25f
+/** Loudness lost per second after a noise was made */
+#define SOUND_DECAY         200.0f
+/** Loudness a guard needs at its node to hear something */
+#define SOUND_HEARING       1.0f
+
+class SoundField {
+private:
+    /** Neighbours of each nav node */
+    std::vector<std::vector<int>> _adjacency;
+    /** Position of each nav node */
+    std::vector<Vec2> _positions;
+    /** Loudness each node had at the time in `_stamp` */
+    std::vector<float> _level;
+    /** Clock time of the loudest noise that reached each node */
+    std::vector<float> _stamp;
+    /** Scratch distances for the flood, reset per event */
+    std::vector<float> _dist;
+    /** Nodes touched by the last flood, so resetting `_dist` stays bounded */
+    std::vector<int> _touched;
+    /** Time since the field was built, in seconds */
+    float _clock;
+    /** Nodes settled by the last flood */
+    int _lastFlood;
+
+public:
+    SoundField() : _clock(0), _lastFlood(0) {}
+
+    /**
+     * Builds adjacency lists from the nav graph.
+     *
+     * @param adjMatrix The nav graph adjacency matrix
+     * @param nodes     Nav node index to position
+     */
+    void init(bool** adjMatrix, const std::unordered_map<int, Vec2>& nodes) {
+        int n = (int)nodes.size();
+        _adjacency.assign(n, std::vector<int>());
+        _positions.assign(n, Vec2(0, 0));
+        for (auto& node : nodes) {
+            if (node.first >= 0 && node.first < n) {
+                _positions[node.first] = node.second;
+            }
+        }
+        for (int u = 0; u < n && adjMatrix != nullptr; u++) {
+            for (int v = 0; v < n; v++) {
+                if (adjMatrix[u][v]) {
+                    _adjacency[u].push_back(v);
+                }
+            }
+        }
+        _level.assign(n, 0);
+        _stamp.assign(n, 0);
+        _dist.assign(n, -1);
+        _touched.clear();
+        _clock = 0;
+        _lastFlood = 0;
+    }
+
+    /** Advances the field clock; loudness decays from it lazily */
+    void update(float dt) {
+        _clock += dt;
+    }
+
+    /**
+     * Spreads a noise from `source` until it falls silent.
+     *
+     * @param source    The nav node the noise was made at
+     * @param loudness  How far along the graph the noise carries
+     */
+    void emit(int source, float loudness) {
+        int n = (int)_adjacency.size();
+        if (source < 0 || source >= n || loudness <= 0) {
+            return;
+        }
+        for (int v : _touched) {
+            _dist[v] = -1;
+        }
+        _touched.clear();
+        _lastFlood = 0;
+
+        typedef std::pair<float, int> Entry;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        _dist[source] = 0;
+        _touched.push_back(source);
+        open.push(Entry(0, source));
+
+        while (!open.empty()) {
+            Entry top = open.top();
+            open.pop();
+            int u = top.second;
+            if (top.first > _dist[u]) {
+                continue;
+            }
+            _lastFlood += 1;
+
+            float level = loudness - top.first;
+            if (level > loudnessAt(u)) {
+                _level[u] = level;
+                _stamp[u] = _clock;
+            }
+
+            for (int v : _adjacency[u]) {
+                float d = top.first + _positions[u].distance(_positions[v]);
+                // attenuation bounds the flood: stop once the noise is spent
+                if (d >= loudness) {
+                    continue;
+                }
+                if (_dist[v] < 0) {
+                    _touched.push_back(v);
+                }
+                else if (d >= _dist[v]) {
+                    continue;
+                }
+                _dist[v] = d;
+                open.push(Entry(d, v));
+            }
+        }
+    }
+
+    /** Returns the current loudness at a nav node */
+    float loudnessAt(int node) {
+        if (node < 0 || node >= _level.size()) {
+            return 0;
+        }
+        float level = _level[node] - SOUND_DECAY * (_clock - _stamp[node]);
+        return level > 0 ? level : 0;
+    }
+
+    /** Returns whether a guard standing on `node` hears anything */
+    bool audible(int node) {
+        return loudnessAt(node) > SOUND_HEARING;
+    }
+
+    /** Returns the nodes the last flood settled, for profiling */
+    int getLastFloodSize() {
+        return _lastFlood;
+    }
+
+    /** Silences the whole field */
+    void clear() {
+        _level.assign(_level.size(), 0);
+        _stamp.assign(_stamp.size(), _clock);
+    }
+
+    /** Silences the field and restarts its clock, as if just built */
+    void reset() {
+        _clock = 0;
+        clear();
+    }
+};
+
+#endif /* __SOUND_FIELD_H__ */
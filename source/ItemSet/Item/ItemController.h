@@ -10,6 +10,7 @@
 
 #include "ItemModel.h"
 #include "ItemView.h"
+#include <SlotMap.h>
 
 /**
  * A class communicating between the model and the view. It only
@@ -26,13 +27,13 @@ private:
 
     bool can_be_collected;
 
-private: int _id;
+private: SlotHandle _handle;
 
     
 #pragma mark Main Methods
 public:
 
-    const int& id;
+    const SlotHandle& handle;
 
 
     /**
@@ -43,10 +44,10 @@ public:
      * @param color     The tile color
      */
     ItemController(Vec2 position, Size size, bool isArtifact, bool isResource, bool isObs, bool isExit,
-        const std::shared_ptr<cugl::AssetManager>& assets, std::string textureKey, int id) : id(_id) {
+        const std::shared_ptr<cugl::AssetManager>& assets, std::string textureKey, SlotHandle handle) : handle(_handle) {
         _model = std::make_unique<ItemModel>(position, size, isArtifact, isResource, isObs, isExit, textureKey);
-        _view = std::make_unique<ItemView>(position, size, isArtifact, isResource, isObs, isExit, assets, textureKey, id);
-        _id = id;
+        _view = std::make_unique<ItemView>(position, size, isArtifact, isResource, isObs, isExit, assets, textureKey);
+        _handle = handle;
         if (isResource || isArtifact) {
             can_be_collected = true;
         } else {
@@ -155,6 +156,10 @@ public:
         _view->setAction(actions);
     }
 
+    void setAnimator(std::shared_ptr<SpriteAnimator> animator) {
+        _view->setAnimator(animator);
+    }
+
     void updateAnim() {
         _view->updateAnim();
     }
@@ -163,6 +168,14 @@ public:
         _view->removeAnim();
         can_be_collected = false;
     }
+
+    /** Undoes `removeAnim`, for a restart */
+    void restore() {
+        if (_model->isResource() || _model->isArtifact()) {
+            _view->restoreAnim();
+            can_be_collected = true;
+        }
+    }
     
     
     void updateTransparency(){
@@ -9,6 +9,7 @@
 #define ItemView_h
 
 #include <cugl/cugl.h>
+#include <Animation/SpriteAnimator.h>
 #include <math.h>
 //using namespace cugl;
 
@@ -24,17 +25,18 @@ private:
     bool _isObs;
     bool _isExit;
 
-    std::shared_ptr<cugl::scene2::Animate> _c_0;
-
     /** Manager to process the animation actions */
     std::shared_ptr<cugl::scene2::ActionManager> _actions;
 
-    int _id;
+    /** Ticker that plays the item animation */
+    std::shared_ptr<SpriteAnimator> _animator;
+    /** Track of the animated sprite, -1 until it is registered */
+    int _track;
     
 #pragma mark Main Functions
 public:
     /** contructor */
-    ItemView(Vec2 position, Size size, bool isArtifact, bool isResource, bool isObs, bool isExit, const std::shared_ptr<cugl::AssetManager>& assets, std::string textureKey, int id) {
+    ItemView(Vec2 position, Size size, bool isArtifact, bool isResource, bool isObs, bool isExit, const std::shared_ptr<cugl::AssetManager>& assets, std::string textureKey) {
         _static_node = scene2::PolygonNode::alloc();
         setPosition(position);
 
@@ -42,16 +44,13 @@ public:
         _isResource = isResource;
         _isObs = isObs;
         _isExit = isExit;
-        _id = id;
-
-
-        std::vector<int> d0 = {1,2,3,4,5,6,7,0};
-        _c_0 = cugl::scene2::Animate::alloc(d0, 1.0f);
-
-
+        _track = -1;
     }
     
     ~ItemView(){
+        if (_animator != nullptr) {
+            _animator->remove(_track);
+        }
         auto parent = _static_node->getParent();
         if (parent != nullptr && _static_node != nullptr) {
             parent->removeChild(_static_node);
@@ -82,6 +81,10 @@ public:
         _anim_node->setVisible(false);
     }
 
+    void restoreAnim() {
+        _anim_node->setVisible(true);
+    }
+
 #pragma mark Setters
 public:
     void setPosition(Vec2 position){
@@ -92,6 +95,26 @@ public:
         _actions = actions;
     }
 
+    /** Registers the animated sprite with `animator`, so play never has to */
+    void setAnimator(std::shared_ptr<SpriteAnimator> animator) {
+        if (animator == _animator) {
+            return;
+        }
+        if (_animator != nullptr) {
+            _animator->remove(_track);
+            _track = -1;
+        }
+        _animator = animator;
+        registerTrack();
+    }
+
+    /** Adds the track of the animated sprite once there is one and an animator */
+    void registerTrack() {
+        if (_track < 0 && _animator != nullptr && _anim_node != nullptr) {
+            _track = _animator->add(_anim_node, _static_node);
+        }
+    }
+
     void setSize(Size size){
         _static_node->setContentSize(size);
     }
@@ -103,6 +126,11 @@ public:
     void setTexture(const std::shared_ptr<cugl::AssetManager>& assets, std::string textureKey) {
         //        auto node = scene2::SceneNode::alloc();
         Vec2 pos = nodePos();
+        if (_animator != nullptr && _track >= 0) {
+            // the track follows the new sprite below
+            _animator->remove(_track);
+            _track = -1;
+        }
 
         if (_isResource) {
             std::shared_ptr<Texture> texture  = assets->get<Texture>(textureKey);
@@ -159,15 +187,15 @@ public:
                 _static_node->setVisible(false);
             }
         }
+        registerTrack();
     }
 
     void updateAnim() {
-        if (_actions->isActive("item"+ std::to_string(_id))){
-            // let it finish
-        }
-        else {
-            _actions->activate("item"+ std::to_string(_id), _c_0, _anim_node);
+        if (_animator == nullptr || _track < 0) {
+            return;
         }
+        // keeps looping if it is already playing
+        _animator->play(_track, AnimationClipSet::item().get(0, 0).get());
 
     }
     
@@ -30,7 +30,8 @@ public:
     int artCount;
     int resCount;
 
-    std::vector<int> _usedIDs;
+    /** handles of the items in this set */
+    SlotMap<ItemController*> _handles;
 
 
 
@@ -58,32 +59,23 @@ public:
     
     void add_this(Vec2 pos, Size size, bool isArtifact, bool isResource, bool isWall, bool isExit,
         const std::shared_ptr<cugl::AssetManager>& assets, std::string textureKey){
-        int new_id = generateUniqueID();
-        Item _item = std::make_unique<ItemController>(pos, size, isArtifact, isResource, isWall, isExit, assets, textureKey, new_id);
+        SlotHandle handle = _handles.insert(nullptr);
+        Item _item = std::make_unique<ItemController>(pos, size, isArtifact, isResource, isWall, isExit, assets, textureKey, handle);
+        *_handles.get(handle) = _item.get();
         _itemSet.push_back(std::move(_item));
     }
 
-    int generateUniqueID() {
-        int id = 0;
-        bool isUsed = true;
-        while (isUsed){
-            id = rand() % 900 + 100;
-            if (std::find(_usedIDs.begin(), _usedIDs.end(), id) != _usedIDs.end()) {
-                id = rand() % 900 + 100;
-            }
-            else {
-                _usedIDs.push_back(id);
-                isUsed = false;
-            }
-        }
-
-        return id;
+    /** Returns the item for `handle`, or nullptr if it is gone */
+    ItemController* getItem(const SlotHandle& handle) {
+        ItemController** item = _handles.get(handle);
+        return item == nullptr ? nullptr : *item;
     }
 
     // idx is the idx of this item in this vec
     void remove_this(int idx, std::shared_ptr<cugl::scene2::OrderedNode>& s){
         if (_itemSet[idx]->isArtifact()) {
             _itemSet[idx]->removeChildFrom(s);
+            _handles.erase(_itemSet[idx]->handle);
             _itemSet.erase(_itemSet.begin() + idx);
         }
         else if (_itemSet[idx]->isResource()) {
@@ -109,8 +101,16 @@ public:
         }
     }
     
+    /** Makes every item collectable again, for a restart */
+    void restore() {
+        for (auto& item : _itemSet) {
+            item->restore();
+        }
+    }
+    
     void clearSet () {
         _itemSet.clear();
+        _handles.clear();
     }
     
     void setVisibility(bool visible){
@@ -167,6 +167,8 @@ public:
     std::shared_ptr<ItemSetController> copy() {
         std::shared_ptr<ItemSetController> temp = std::make_shared<ItemSetController>();
         temp->_itemSet = std::vector<Item>(this->_itemSet);
+        // the copy shares the items, so the same handles find them
+        temp->_handles = _handles;
         return temp;
     }
     
@@ -208,6 +210,15 @@ public:
         }
     }
 
+    void setAnimator(std::shared_ptr<SpriteAnimator> animator){
+        unsigned int vecSize = _itemSet.size();
+        for(unsigned int i = 0; i < vecSize; i++) {
+            if(_itemSet[i] != nullptr){
+                _itemSet[i]->setAnimator(animator);
+            }
+        }
+    }
+
     void updateAnim() {
         unsigned int vecSize = _itemSet.size();
         for(unsigned int i = 0; i < vecSize; i++) {
@@ -48,11 +48,10 @@ public:
     isInitiating(_isInitiating)
     {
         std::vector<cugl::Vec2> Path;
-        std::vector<std::shared_ptr<scene2::PolygonNode>> pathLines;
         _isDrawing = false;
         _isInitiating = false;
         _model = std::make_unique<PathModel>(Color4::BLACK, 12, Vec2::ZERO, Path);
-        _view = std::make_unique<PathView>(pathLines, Color4::BLACK, 12, assets);
+        _view = std::make_unique<PathView>(Color4::BLACK, 12, assets);
     }
     
 #pragma mark Update Methods
@@ -123,14 +122,13 @@ public:
      */
     
     void addSegment(Vec2 pos, const std::shared_ptr<cugl::Scene2>& scene){
-        Spline2 spline = Spline2(_model->lastPos, pos);
         Vec2 point = _model->lastPos.getMidpoint(pos);
         _model->addToPath(point);
         // not going to work now because the path size will change when drawing the path
 //        if (_model->Path.size() % 2 == 0){
-//            _view->addToPathLines(spline, point, scene);
+//            _view->addToPathLines(point, scene);
 //        }
-        _view->addToPathLines(spline, point, scene);
+        _view->addToPathLines(point, scene);
         updateLastPos(pos);
     }
     
@@ -0,0 +1,89 @@
+//
+//  PathTrail.h
+//  Tilemap
+//
+//  The drawn path as a single scene node. Brush stamps are kept in a queue
+//  in path order: a new checkpoint appends one, the character consuming a
+//  checkpoint pops the oldest, and the node draws the queue as textured
+//  quads into the sprite batch. A long drag then adds no scene children.
+//
+
+#ifndef __PATH_TRAIL_H__
+#define __PATH_TRAIL_H__
+
+#include <cugl/cugl.h>
+#include <deque>
+
+class PathTrail : public cugl::scene2::SceneNode {
+private:
+    /** One checkpoint of the path */
+    struct Stamp {
+        cugl::Vec2 pos;
+        /** Only every other checkpoint shows a brush */
+        bool drawn;
+    };
+
+    std::deque<Stamp> _stamps;
+    std::shared_ptr<cugl::Texture> _brush;
+    /** Brush quad centered on the origin */
+    cugl::Rect _bounds;
+
+public:
+    PathTrail() {}
+
+    /**
+     * Allocates an empty trail drawn in the coordinates of its parent.
+     *
+     * @param brush The brush texture
+     * @param scale The brush size against the texture
+     */
+    static std::shared_ptr<PathTrail> alloc(const std::shared_ptr<cugl::Texture>& brush, float scale) {
+        std::shared_ptr<PathTrail> result = std::make_shared<PathTrail>();
+        if (!result->init()) {
+            return nullptr;
+        }
+        result->setAnchor(cugl::Vec2::ANCHOR_BOTTOM_LEFT);
+        result->setPosition(cugl::Vec2::ZERO);
+        result->_brush = brush;
+        if (brush != nullptr) {
+            cugl::Size size = brush->getSize() * scale;
+            result->_bounds = cugl::Rect(-size.width / 2, -size.height / 2, size.width, size.height);
+        }
+        return result;
+    }
+
+    /** Appends a checkpoint at the end of the path */
+    void push(cugl::Vec2 pos, bool drawn) {
+        _stamps.push_back({ pos, drawn });
+    }
+
+    /** Removes the checkpoint at the front of the path */
+    void pop() {
+        if (!_stamps.empty()) {
+            _stamps.pop_front();
+        }
+    }
+
+    void clear() {
+        _stamps.clear();
+    }
+
+    size_t size() const {
+        return _stamps.size();
+    }
+
+    /** Draws the brush stamps, one batched quad each */
+    void draw(const std::shared_ptr<cugl::SpriteBatch>& batch, const cugl::Affine2& transform, cugl::Color4 tint) override {
+        if (_brush == nullptr) {
+            return;
+        }
+        for (const Stamp& stamp : _stamps) {
+            if (stamp.drawn) {
+                cugl::Rect quad(_bounds.origin + stamp.pos, _bounds.size);
+                batch->draw(_brush, tint, quad, cugl::Vec2::ZERO, transform);
+            }
+        }
+    }
+};
+
+#endif /* __PATH_TRAIL_H__ */
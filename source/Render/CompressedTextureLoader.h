@@ -0,0 +1,205 @@
+//
+//  CompressedTextureLoader.h
+//  Tilemap
+//
+//  A texture loader that swaps the large sprite sheets for the GPU
+//  compressed copies written by tools/texture_compressor.py. Those are
+//  listed in json/compressed.json by the PNG they replace. A texture in the
+//  list is uploaded from the best KTX file the device can sample (ASTC,
+//  then ETC2 on OpenGL ES 3) and stays compressed in video memory, with the
+//  mip levels stored in the file when its entry asks for mipmaps. Every
+//  other texture, and every texture when the list is missing, goes through
+//  the plain TextureLoader.
+//
+
+#ifndef __COMPRESSED_TEXTURE_LOADER_H__
+#define __COMPRESSED_TEXTURE_LOADER_H__
+
+#include <cugl/cugl.h>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC        0x9278
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_6x6_KHR
+#define GL_COMPRESSED_RGBA_ASTC_6x6_KHR     0x93B4
+#endif
+
+/** The variant list written by the converter */
+#define COMPRESSED_MANIFEST     "json/compressed.json"
+
+class CompressedTextureLoader : public cugl::TextureLoader {
+private:
+    /** The image of a KTX 1.1 file, with its mip levels largest first */
+    struct KTXImage {
+        GLenum format;
+        int width;
+        int height;
+        std::vector<std::vector<char>> levels;
+    };
+
+    /** Compressed file of each PNG, for the format this device uses */
+    std::unordered_map<std::string, std::string> _variants;
+
+    /** Returns the variant key of the best format the GPU samples, or "" */
+    static std::string preferredFormat() {
+#if CU_GL_PLATFORM == CU_GL_OPENGLES
+        const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+        if (extensions != nullptr && std::strstr(extensions, "GL_KHR_texture_compression_astc_ldr") != nullptr) {
+            return "astc";
+        }
+        // part of OpenGL ES 3
+        return "etc2";
+#else
+        // desktop drivers unpack ETC2 to RGBA8, keep the PNG
+        return "";
+#endif
+    }
+
+    /** Reads a file written by the converter, or returns nullptr */
+    static std::shared_ptr<KTXImage> readKTX(const std::string& source) {
+        static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+        std::string path = cugl::Application::get()->getAssetDirectory() + source;
+        SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+        if (file == nullptr) {
+            return nullptr;
+        }
+        unsigned char head[12];
+        Uint32 fields[13];
+        std::shared_ptr<KTXImage> image = std::make_shared<KTXImage>();
+        bool ok = SDL_RWread(file, head, 1, 12) == 12 && std::memcmp(head, identifier, 12) == 0
+               && SDL_RWread(file, fields, 4, 13) == 13 && fields[0] == 0x04030201 && fields[12] == 0;
+        if (ok) {
+            // the internal format, the size and the mip count; the converter
+            // writes no key/value data
+            image->format = fields[4];
+            image->width = fields[6];
+            image->height = fields[7];
+            image->levels.resize(fields[11]);
+        }
+        for (int i = 0; ok && i < image->levels.size(); i++) {
+            Uint32 size = 0;
+            char padding[4];
+            ok = SDL_RWread(file, &size, 4, 1) == 1;
+            image->levels[i].resize(size);
+            ok = ok && SDL_RWread(file, image->levels[i].data(), 1, size) == size;
+            ok = ok && (size % 4 == 0 || SDL_RWread(file, padding, 1, 4 - size % 4) == 4 - size % 4);
+        }
+        ok = ok && !image->levels.empty();
+        SDL_RWclose(file);
+        return ok ? image : nullptr;
+    }
+
+    /** Uploads a compressed image; the texture is created like an empty one and respecified */
+    bool materializeKTX(const std::string& key, const std::shared_ptr<KTXImage>& image,
+                        const std::string& fallback, cugl::LoaderCallback callback) {
+        size_t bytes = 0;
+        _queue.erase(key);
+        if (image == nullptr) {
+            CULog("compressed %s unreadable, loading %s", key.c_str(), fallback.c_str());
+            return cugl::TextureLoader::read(key, fallback, callback, false);
+        }
+        std::shared_ptr<cugl::Texture> texture = cugl::Texture::alloc(nullptr, image->width, image->height);
+        texture->bind();
+        for (int i = 0; i < image->levels.size(); i++) {
+            const std::vector<char>& level = image->levels[i];
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, image->format, std::max(1, image->width >> i),
+                                   std::max(1, image->height >> i), 0, (GLsizei)level.size(), level.data());
+            bytes += level.size();
+        }
+        texture->unbind();
+        if (image->levels.size() > 1) {
+            texture->setMinFilter(GL_LINEAR_MIPMAP_LINEAR);
+        }
+        _assets[key] = texture;
+        CULog("%s loaded compressed, %zu levels, %zu KB", key.c_str(), image->levels.size(), bytes / 1024);
+        if (callback != nullptr) {
+            callback(key, true);
+        }
+        return true;
+    }
+
+    /** Loads `key` from `variant`, on the loader thread when async */
+    bool readCompressed(const std::string& key, const std::string& variant, const std::string& source,
+                        cugl::LoaderCallback callback, bool async) {
+        if (_assets.find(key) != _assets.end() || _queue.find(key) != _queue.end()) {
+            return false;
+        }
+        _queue.emplace(key);
+        if (_loader == nullptr || !async) {
+            return materializeKTX(key, readKTX(variant), source, callback);
+        }
+        _loader->addTask([=](void) {
+            // the file is read here, the upload waits for the main thread
+            std::shared_ptr<KTXImage> image = readKTX(variant);
+            cugl::Application::get()->schedule([=](void) {
+                this->materializeKTX(key, image, source, callback);
+                return false;
+            });
+        });
+        return true;
+    }
+
+public:
+    CompressedTextureLoader() {}
+
+    static std::shared_ptr<CompressedTextureLoader> alloc() {
+        std::shared_ptr<CompressedTextureLoader> result = std::make_shared<CompressedTextureLoader>();
+        return (result->init() ? result : nullptr);
+    }
+
+    /** Reads the variant list; without one this is a plain TextureLoader */
+    bool init() {
+        if (!cugl::TextureLoader::init()) {
+            return false;
+        }
+        std::string format = preferredFormat();
+        std::shared_ptr<cugl::JsonReader> reader = cugl::JsonReader::allocWithAsset(COMPRESSED_MANIFEST);
+        if (format.empty() || reader == nullptr) {
+            return true;
+        }
+        std::shared_ptr<cugl::JsonValue> json = reader->readJson();
+        reader->close();
+        for (int i = 0; json != nullptr && i < json->size(); i++) {
+            std::shared_ptr<cugl::JsonValue> entry = json->get(i);
+            // ETC2 is the fallback of a device without ASTC
+            std::string variant = entry->getString(format, entry->getString("etc2", ""));
+            if (!variant.empty()) {
+                _variants[entry->key()] = variant;
+            }
+        }
+        CULog("%zu compressed textures available as %s", _variants.size(), format.c_str());
+        return true;
+    }
+
+    bool read(const std::string key, const std::string source, cugl::LoaderCallback callback, bool async) override {
+        auto it = _variants.find(source);
+        if (it == _variants.end()) {
+            return cugl::TextureLoader::read(key, source, callback, async);
+        }
+        return readCompressed(key, it->second, source, callback, async);
+    }
+
+    bool read(const std::shared_ptr<cugl::JsonValue>& json, cugl::LoaderCallback callback, bool async) override {
+        // sub-textures, wrapping and magnification need the PNG path; the
+        // mipmaps come with the file
+        bool plain = json->has("file");
+        for (int i = 0; plain && i < json->size(); i++) {
+            std::string field = json->get(i)->key();
+            plain = field == "file" || field == "mipmaps" || field == "minfilter";
+        }
+        if (plain) {
+            std::string source = json->getString("file");
+            auto it = _variants.find(source);
+            if (it != _variants.end()) {
+                return readCompressed(json->key(), it->second, source, callback, async);
+            }
+        }
+        return cugl::TextureLoader::read(json, callback, async);
+    }
+};
+
+#endif /* __COMPRESSED_TEXTURE_LOADER_H__ */
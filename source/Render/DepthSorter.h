@@ -0,0 +1,169 @@
+//
+//  DepthSorter.h
+//  Tilemap
+//
+//  Y-sorting for one world's ordered root. Walls, obstacles, items and exits
+//  never move, so their priorities are set once when the level is built and
+//  kept here as a sorted list. Each frame only the moving sprites (the
+//  character and the guards) are placed into the gap of that list they fall
+//  in, with an insertion pass over the previous frame's order, and a sprite
+//  is only given a new priority when its gap or its place among the other
+//  movers changed. The ordered root then has nothing to re-sort on most
+//  frames.
+//
+
+#ifndef __DEPTH_SORTER_H__
+#define __DEPTH_SORTER_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <algorithm>
+
+/** Priority room given to movers below the lowest or above the highest static sprite */
+#define DEPTH_EDGE_GAP      4096.0f
+
+class DepthSorter {
+private:
+    /** One moving sprite */
+    struct Mover {
+        /** The sprite, owned by its view */
+        cugl::scene2::SceneNode* node;
+        float y;
+        /** Number of static priorities at or below `y` */
+        int slot;
+        /** Priority last given to the node */
+        float priority;
+    };
+
+    /** Priorities of the static sprites, ascending */
+    std::vector<float> _statics;
+    /** Movers in the order they were handed to `update` */
+    std::vector<Mover> _movers;
+    /** Indices into `_movers` sorted by slot, then y */
+    std::vector<int> _order;
+    /** Priority changes made by the last `update` */
+    int _changes;
+
+    /** Walks the slot of `m` to its new y; movers only go a little way per frame */
+    void reslot(Mover& m) const {
+        int n = (int)_statics.size();
+        while (m.slot > 0 && _statics[m.slot - 1] > m.y) {
+            m.slot -= 1;
+        }
+        while (m.slot < n && _statics[m.slot] <= m.y) {
+            m.slot += 1;
+        }
+    }
+
+    bool before(int a, int b) const {
+        const Mover& ma = _movers[a];
+        const Mover& mb = _movers[b];
+        return ma.slot < mb.slot || (ma.slot == mb.slot && ma.y < mb.y);
+    }
+
+public:
+    DepthSorter() : _changes(0) {}
+
+    /**
+     * Records the priorities of every child of `root` that is not a mover.
+     * Call once the level is built and the static sprites have their
+     * priorities.
+     *
+     * @param root      The ordered root of one world
+     * @param movers    The sprites that will be passed to `update`
+     */
+    void freeze(const std::shared_ptr<cugl::scene2::OrderedNode>& root,
+                const std::vector<cugl::scene2::SceneNode*>& movers) {
+        _statics.clear();
+        for (auto& child : root->getChildren()) {
+            if (std::find(movers.begin(), movers.end(), child.get()) == movers.end()) {
+                _statics.push_back(child->getPriority());
+            }
+        }
+        std::sort(_statics.begin(), _statics.end());
+        _movers.clear();
+        _order.clear();
+    }
+
+    /**
+     * Re-prioritizes the moving sprites of this world.
+     *
+     * @param movers    The sprites under this root, in the same order every frame
+     */
+    void update(const std::vector<cugl::scene2::SceneNode*>& movers) {
+        _changes = 0;
+        bool same = movers.size() == _movers.size();
+        for (int i = 0; same && i < movers.size(); i++) {
+            same = movers[i] == _movers[i].node;
+        }
+        if (!same) {
+            // the character switched worlds; start the order over
+            _movers.clear();
+            _order.clear();
+            for (int i = 0; i < movers.size(); i++) {
+                Mover m = { movers[i], movers[i]->getPosition().y, 0, movers[i]->getPriority() };
+                m.slot = (int)(std::upper_bound(_statics.begin(), _statics.end(), m.y) - _statics.begin());
+                _movers.push_back(m);
+                _order.push_back(i);
+            }
+        }
+        else {
+            for (auto& m : _movers) {
+                m.y = m.node->getPosition().y;
+                reslot(m);
+            }
+        }
+
+        // insertion pass, the order from last frame is nearly sorted
+        for (int i = 1; i < _order.size(); i++) {
+            int k = _order[i];
+            int j = i - 1;
+            while (j >= 0 && before(k, _order[j])) {
+                _order[j + 1] = _order[j];
+                j -= 1;
+            }
+            _order[j + 1] = k;
+        }
+
+        // spread each gap's movers evenly between the statics around it
+        int n = (int)_statics.size();
+        for (int i = 0; i < _order.size(); ) {
+            int slot = _movers[_order[i]].slot;
+            int end = i;
+            while (end < _order.size() && _movers[_order[end]].slot == slot) {
+                end += 1;
+            }
+            float lo, hi;
+            if (n == 0) {
+                lo = -DEPTH_EDGE_GAP;
+                hi = DEPTH_EDGE_GAP;
+            }
+            else {
+                lo = slot > 0 ? _statics[slot - 1] : _statics[0] - DEPTH_EDGE_GAP;
+                hi = slot < n ? _statics[slot] : _statics[n - 1] + DEPTH_EDGE_GAP;
+            }
+            int count = end - i;
+            for (int k = 0; k < count; k++) {
+                Mover& m = _movers[_order[i + k]];
+                float priority = lo + (hi - lo) * (k + 1) / (count + 1);
+                if (priority != m.priority) {
+                    m.priority = priority;
+                    m.node->setPriority(priority);
+                    _changes += 1;
+                }
+            }
+            i = end;
+        }
+    }
+
+    /** Returns how many priorities the last `update` changed */
+    int getChanges() const {
+        return _changes;
+    }
+
+    size_t staticCount() const {
+        return _statics.size();
+    }
+};
+
+#endif /* __DEPTH_SORTER_H__ */
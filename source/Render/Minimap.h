@@ -0,0 +1,165 @@
+//
+//  Minimap.h
+//  Tilemap
+//
+//  A corner map of the active world. The static layers of each world are
+//  rendered once, after the level is built, into a texture downsampled by
+//  MINIMAP_SCALE. Per frame only the markers of the character, the guards
+//  and the artifacts move on top of it, so the map costs a few untextured
+//  quads instead of another render of the scene.
+//
+
+#ifndef __MINIMAP_H__
+#define __MINIMAP_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+
+/** Size of the map against the world */
+#define MINIMAP_SCALE       (1.0f / 16.0f)
+/** Distance of the map from the screen corner, in points */
+#define MINIMAP_MARGIN      24.0f
+/** Side of a marker, in points */
+#define MINIMAP_MARKER      8.0f
+
+class Minimap {
+private:
+    /** The map and its markers, added to the UI scene */
+    std::shared_ptr<cugl::scene2::SceneNode> _root;
+    /** Baked static layers of the past and the present world */
+    std::shared_ptr<cugl::Scene2Texture> _targets[2];
+    std::shared_ptr<cugl::scene2::PolygonNode> _images[2];
+    /** Marker pool, the first `_used` are drawn this frame */
+    std::vector<std::shared_ptr<cugl::scene2::PolygonNode>> _markers;
+    size_t _used;
+    cugl::Size _mapSize;
+    bool _baked;
+
+public:
+    Minimap() : _used(0), _baked(false) {}
+
+    /**
+     * Sizes the map for a new level. The worlds are baked on the next
+     * `bake`.
+     *
+     * @param mapSize   The world size in points
+     */
+    void init(cugl::Size mapSize) {
+        _mapSize = mapSize;
+        _baked = false;
+        _root = cugl::scene2::SceneNode::alloc();
+        _root->setAnchor(cugl::Vec2::ANCHOR_BOTTOM_RIGHT);
+        _root->setContentSize(mapSize * MINIMAP_SCALE);
+        _markers.clear();
+        _used = 0;
+        for (int i = 0; i < 2; i++) {
+            _targets[i] = cugl::Scene2Texture::alloc(mapSize * MINIMAP_SCALE);
+            _targets[i]->getCamera()->setZoom(MINIMAP_SCALE);
+            _targets[i]->getCamera()->setPosition(cugl::Vec2(mapSize.width / 2, mapSize.height / 2));
+            _targets[i]->getCamera()->update();
+            // added before any marker, so the markers draw on top
+            _images[i] = cugl::scene2::PolygonNode::alloc();
+            _images[i]->setAnchor(cugl::Vec2::ANCHOR_BOTTOM_LEFT);
+            _images[i]->setVisible(false);
+            _root->addChild(_images[i]);
+        }
+    }
+
+    const std::shared_ptr<cugl::scene2::SceneNode>& getNode() const {
+        return _root;
+    }
+
+    bool isBaked() const {
+        return _baked;
+    }
+
+#pragma mark Baking
+    /**
+     * Renders the current children of `scene` into the map of one world.
+     * Anything that should not be on the map must be hidden first. Bake
+     * both worlds in the same frame.
+     *
+     * @param world     0 for the past, 1 for the present
+     * @param scene     The scene of that world
+     * @param batch     The sprite batch to render with
+     */
+    void bake(int world, const std::shared_ptr<cugl::Scene2>& scene, const std::shared_ptr<cugl::SpriteBatch>& batch) {
+        // borrow the children, keeping their order
+        auto children = scene->getChildren();
+        for (auto& child : children) {
+            scene->removeChild(child);
+            _targets[world]->addChild(child);
+        }
+        _targets[world]->render(batch);
+        for (auto& child : children) {
+            _targets[world]->removeChild(child);
+            scene->addChild(child);
+        }
+
+        _images[world]->setTexture(_targets[world]->getTexture());
+        _images[world]->setPolygon(cugl::Rect(cugl::Vec2::ZERO, _mapSize * MINIMAP_SCALE));
+        _images[world]->setPosition(cugl::Vec2::ZERO);
+        _baked = true;
+    }
+
+    /** Shows the map of the active world */
+    void showWorld(int world) {
+        for (int i = 0; i < 2; i++) {
+            if (_images[i]->isVisible() != (i == world)) {
+                _images[i]->setVisible(i == world);
+            }
+        }
+    }
+
+    /**
+     * Places the map in the bottom right corner of the screen.
+     *
+     * @param corner    The bottom right corner of the screen in UI scene coordinates
+     */
+    void setCorner(cugl::Vec2 corner) {
+        _root->setPosition(corner + cugl::Vec2(-MINIMAP_MARGIN, MINIMAP_MARGIN));
+    }
+
+#pragma mark Markers
+    /** Starts the markers of a frame */
+    void beginMarkers() {
+        _used = 0;
+    }
+
+    /**
+     * Draws a marker this frame.
+     *
+     * @param pos   The world position
+     * @param color The marker color
+     */
+    void mark(cugl::Vec2 pos, cugl::Color4 color) {
+        if (_used == _markers.size()) {
+            auto marker = cugl::scene2::PolygonNode::allocWithPoly(cugl::Rect(0, 0, MINIMAP_MARKER, MINIMAP_MARKER));
+            marker->setAnchor(cugl::Vec2::ANCHOR_CENTER);
+            _root->addChild(marker);
+            _markers.push_back(marker);
+        }
+        auto& marker = _markers[_used++];
+        cugl::Vec2 at = pos * MINIMAP_SCALE;
+        if (marker->getPosition() != at) {
+            marker->setPosition(at);
+        }
+        if (marker->getColor() != color) {
+            marker->setColor(color);
+        }
+        if (!marker->isVisible()) {
+            marker->setVisible(true);
+        }
+    }
+
+    /** Hides the markers not used this frame */
+    void endMarkers() {
+        for (size_t i = _used; i < _markers.size(); i++) {
+            if (_markers[i]->isVisible()) {
+                _markers[i]->setVisible(false);
+            }
+        }
+    }
+};
+
+#endif /* __MINIMAP_H__ */
@@ -0,0 +1,120 @@
+//
+//  PreviewLens.h
+//  Tilemap
+//
+//  The render target behind the other-world preview. Only the circle under
+//  the player's finger is rendered, into a texture the size of the lens,
+//  and only when the lens moved or the signature of the other world
+//  changed. On the other frames the preview is the cached texture on a
+//  single polygon.
+//
+//  The signature only hashes guard positions. Anything else that changes
+//  in the other world (sprite animation frames, an item or switch changing
+//  state) is shown stale for up to LENS_REFRESH seconds.
+//
+
+#ifndef __PREVIEW_LENS_H__
+#define __PREVIEW_LENS_H__
+
+#include <cugl/cugl.h>
+
+/** Longest a cached lens is shown before it is rendered again, for sprite animations */
+#define LENS_REFRESH        0.1f
+
+class PreviewLens {
+private:
+    /** The other world is moved in here while previewing */
+    std::shared_ptr<cugl::Scene2Texture> _target;
+    float _radius;
+    /** World position of the lens center */
+    cugl::Vec2 _center;
+    /** Summary of the moving sprites when the lens was last rendered */
+    float _signature;
+    /** Seconds since the lens was last rendered */
+    float _age;
+    bool _dirty;
+    /** Renders since the preview started */
+    int _renders;
+
+public:
+    PreviewLens() : _radius(0), _signature(0), _age(0), _dirty(true), _renders(0) {}
+
+    /**
+     * Allocates the render target.
+     *
+     * @param radius    The lens radius in world coordinates
+     */
+    void init(float radius) {
+        _radius = radius;
+        _target = cugl::Scene2Texture::alloc(cugl::Size(2 * radius, 2 * radius));
+        invalidate();
+    }
+
+    /** Returns the scene the other world is rendered from */
+    const std::shared_ptr<cugl::Scene2Texture>& getScene() const {
+        return _target;
+    }
+
+    std::shared_ptr<cugl::Texture> getTexture() const {
+        return _target->getTexture();
+    }
+
+    /** Returns the part of the other world the lens shows */
+    cugl::Rect getBounds() const {
+        return cugl::Rect(_center.x - _radius, _center.y - _radius, 2 * _radius, 2 * _radius);
+    }
+
+    /** Returns the lens outline in lens coordinates, for the preview polygon */
+    cugl::Poly2 getShape() const {
+        cugl::PolyFactory factory;
+        return factory.makeCircle(cugl::Vec2(_radius, _radius), _radius);
+    }
+
+    /** Forces a render on the next frame */
+    void invalidate() {
+        _dirty = true;
+        _renders = 0;
+    }
+
+    void moveTo(cugl::Vec2 center) {
+        if (center != _center) {
+            _center = center;
+            _dirty = true;
+        }
+    }
+
+    /**
+     * Marks the lens for a render if the moving sprites of the other world
+     * changed, or the cached one is older than LENS_REFRESH.
+     *
+     * @param signature Any value that changes when the other world changes
+     * @param dt        Seconds since the last frame
+     */
+    void update(float signature, float dt) {
+        _age += dt;
+        if (signature != _signature || _age >= LENS_REFRESH) {
+            _signature = signature;
+            _dirty = true;
+        }
+    }
+
+    /** Renders the other world inside the lens if the cache is stale, returns whether it did */
+    bool render(const std::shared_ptr<cugl::SpriteBatch>& batch) {
+        if (!_dirty) {
+            return false;
+        }
+        _target->getCamera()->setPosition(_center);
+        _target->getCamera()->update();
+        _target->render(batch);
+        _dirty = false;
+        _age = 0;
+        _renders += 1;
+        return true;
+    }
+
+    int getRenders() const {
+        return _renders;
+    }
+};
+
+#endif /* __PREVIEW_LENS_H__ */
@@ -0,0 +1,249 @@
+//
+//  RenderStats.h
+//  Tilemap
+//
+//  Per-frame render counters. Each scene render is recorded as a pass:
+//  the draw calls and vertices the sprite batch reports for it (both are
+//  reset by every begin), and, from a walk of the visible scene graph, the
+//  nodes visited and the texture switches the batch has to flush on. Draw
+//  calls above the texture switches are breaks for other reasons (blend,
+//  scissor, gradient or a full vertex buffer). The averages can be shown
+//  over the UI, and every pass of every frame written to a CSV file.
+//  Compiled into the game only when RENDER_STATS is defined.
+//
+
+#ifndef __RENDER_STATS_H__
+#define __RENDER_STATS_H__
+
+#include <cugl/cugl.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+// #define RENDER_STATS            // count every render pass
+// #define RENDER_STATS_OVERLAY    // show the averages in the top left corner
+// #define RENDER_STATS_CSV        // write every pass to render_stats.csv in the save directory
+
+// either output needs the counters
+#if (defined(RENDER_STATS_OVERLAY) || defined(RENDER_STATS_CSV)) && !defined(RENDER_STATS)
+#define RENDER_STATS
+#endif
+
+/** Frames averaged for each overlay refresh */
+#define RENDER_STATS_INTERVAL   30
+/** Gap between the overlay lines and the screen edge */
+#define RENDER_STATS_MARGIN     24.0f
+
+/** The world scene in view */
+#define RENDER_PASS_WORLD       0
+/** The other world inside the preview lens, only on frames the lens is stale */
+#define RENDER_PASS_LENS        1
+/** Buttons, panels and the minimap */
+#define RENDER_PASS_UI          2
+#define RENDER_PASS_COUNT       3
+
+class RenderStats {
+private:
+    /** Counters of one pass, summed over the frames of an interval */
+    struct Pass {
+        unsigned int calls;
+        unsigned int vertices;
+        unsigned int nodes;
+        unsigned int switches;
+        double ms;
+    };
+
+    Pass _frame[RENDER_PASS_COUNT];
+    Pass _interval[RENDER_PASS_COUNT];
+    int _intervalFrames;
+    unsigned long _frameNumber;
+    std::chrono::steady_clock::time_point _passStart;
+
+    /** One line per pass, and one for the total; empty without an overlay */
+    std::vector<std::shared_ptr<cugl::scene2::Label>> _lines;
+    std::ofstream _csv;
+
+    static const char* name(int pass) {
+        static const char* names[RENDER_PASS_COUNT] = { "world", "lens", "ui" };
+        return names[pass];
+    }
+
+    /**
+     * Counts the visible nodes under `node` and the texture changes between
+     * them in draw order: child order, except under an ordered node, which
+     * draws its children sorted by priority.
+     */
+    static void walk(cugl::scene2::SceneNode* node, Pass& pass, const cugl::Texture*& last) {
+        if (!node->isVisible()) {
+            return;
+        }
+        pass.nodes += 1;
+        cugl::scene2::TexturedNode* textured = dynamic_cast<cugl::scene2::TexturedNode*>(node);
+        if (textured != nullptr && textured->getTexture().get() != last) {
+            last = textured->getTexture().get();
+            pass.switches += 1;
+        }
+        std::vector<cugl::scene2::SceneNode*> children;
+        for (unsigned int i = 0; i < node->getChildCount(); i++) {
+            children.push_back(node->getChild(i).get());
+        }
+        cugl::scene2::OrderedNode* ordered = dynamic_cast<cugl::scene2::OrderedNode*>(node);
+        if (ordered != nullptr) {
+            typedef cugl::scene2::OrderedNode::Order Order;
+            Order order = ordered->getOrder();
+            if (order == Order::ASCEND || order == Order::PRE_ASCEND) {
+                std::stable_sort(children.begin(), children.end(), [](cugl::scene2::SceneNode* a, cugl::scene2::SceneNode* b) {
+                    return a->getPriority() < b->getPriority();
+                });
+            }
+            else if (order == Order::DESCEND || order == Order::PRE_DESCEND) {
+                std::stable_sort(children.begin(), children.end(), [](cugl::scene2::SceneNode* a, cugl::scene2::SceneNode* b) {
+                    return a->getPriority() > b->getPriority();
+                });
+            }
+        }
+        for (cugl::scene2::SceneNode* child : children) {
+            walk(child, pass, last);
+        }
+    }
+
+    void refresh() {
+        Pass total = {};
+        for (int i = 0; i < RENDER_PASS_COUNT; i++) {
+            const Pass& pass = _interval[i];
+            total.calls += pass.calls;
+            total.vertices += pass.vertices;
+            total.ms += pass.ms;
+            if (!_lines.empty()) {
+                char text[128];
+                std::snprintf(text, sizeof(text), "%-5s %5.1f calls %7.0f verts %5.1f switches %6.0f nodes",
+                              name(i), (float)pass.calls / _intervalFrames, (float)pass.vertices / _intervalFrames,
+                              (float)pass.switches / _intervalFrames, (float)pass.nodes / _intervalFrames);
+                _lines[i]->setText(text, true);
+            }
+        }
+        if (!_lines.empty()) {
+            char text[128];
+            std::snprintf(text, sizeof(text), "total %5.1f calls %7.0f verts %6.2f ms submit",
+                          (float)total.calls / _intervalFrames, (float)total.vertices / _intervalFrames,
+                          total.ms / _intervalFrames);
+            _lines[RENDER_PASS_COUNT]->setText(text, true);
+        }
+        for (int i = 0; i < RENDER_PASS_COUNT; i++) {
+            _interval[i] = {};
+        }
+        _intervalFrames = 0;
+    }
+
+public:
+    RenderStats() : _frame(), _interval(), _intervalFrames(0), _frameNumber(0) {}
+
+    ~RenderStats() {
+        if (_csv.is_open()) {
+            _csv.close();
+        }
+    }
+
+    /**
+     * Starts writing one row per pass and frame.
+     *
+     * @param path  The file to (over)write
+     *
+     * @return false if the file could not be opened
+     */
+    bool openCSV(const std::string& path) {
+        _csv.open(path, std::ios::trunc);
+        if (!_csv.is_open()) {
+            CULog("render stats: cannot write %s", path.c_str());
+            return false;
+        }
+        _csv << "frame,pass,calls,vertices,nodes,switches,ms\n";
+        CULog("render stats written to %s", path.c_str());
+        return true;
+    }
+
+    /**
+     * Adds the overlay lines to `scene`. Call again whenever the scene is
+     * cleared.
+     *
+     * @param font  The font of the lines
+     * @param scene The UI scene
+     */
+    void showOverlay(const std::shared_ptr<cugl::Font>& font, const std::shared_ptr<cugl::Scene2>& scene) {
+        if (_lines.empty()) {
+            for (int i = 0; i <= RENDER_PASS_COUNT; i++) {
+                std::shared_ptr<cugl::scene2::Label> line = cugl::scene2::Label::allocWithText("render stats", font);
+                line->setAnchor(cugl::Vec2::ANCHOR_TOP_LEFT);
+                line->setForeground(cugl::Color4::WHITE);
+                _lines.push_back(line);
+            }
+        }
+        for (auto& line : _lines) {
+            if (line->getParent() == nullptr) {
+                scene->addChild(line);
+            }
+        }
+    }
+
+    /**
+     * Keeps the overlay in the top left corner of the screen.
+     *
+     * @param corner    The top left corner of the screen in UI scene coordinates
+     */
+    void setCorner(cugl::Vec2 corner) {
+        float y = corner.y - RENDER_STATS_MARGIN;
+        for (auto& line : _lines) {
+            line->setPosition(corner.x + RENDER_STATS_MARGIN, y);
+            y -= line->getContentSize().height;
+        }
+    }
+
+    /** Call right before a scene renders */
+    void beginPass() {
+        _passStart = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * Records the scene just rendered.
+     *
+     * @param pass  One of the RENDER_PASS constants
+     * @param scene The scene rendered since beginPass
+     * @param batch The batch it was rendered with
+     */
+    void endPass(int pass, const std::shared_ptr<cugl::Scene2>& scene, const std::shared_ptr<cugl::SpriteBatch>& batch) {
+        Pass& counts = _frame[pass];
+        counts.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _passStart).count();
+        counts.calls += batch->getCallsMade();
+        counts.vertices += batch->getVerticesDrawn();
+        const cugl::Texture* last = nullptr;
+        for (auto& child : scene->getChildren()) {
+            walk(child.get(), counts, last);
+        }
+    }
+
+    /** Call once every pass of the frame is recorded */
+    void endFrame() {
+        for (int i = 0; i < RENDER_PASS_COUNT; i++) {
+            Pass& pass = _frame[i];
+            if (_csv.is_open() && pass.calls > 0) {
+                _csv << _frameNumber << ',' << name(i) << ',' << pass.calls << ',' << pass.vertices << ','
+                     << pass.nodes << ',' << pass.switches << ',' << pass.ms << '\n';
+            }
+            _interval[i].calls += pass.calls;
+            _interval[i].vertices += pass.vertices;
+            _interval[i].nodes += pass.nodes;
+            _interval[i].switches += pass.switches;
+            _interval[i].ms += pass.ms;
+            pass = {};
+        }
+        _frameNumber += 1;
+        _intervalFrames += 1;
+        if (_intervalFrames == RENDER_STATS_INTERVAL) {
+            refresh();
+        }
+    }
+};
+
+#endif /* __RENDER_STATS_H__ */
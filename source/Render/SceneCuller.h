@@ -0,0 +1,212 @@
+//
+//  SceneCuller.h
+//  Tilemap
+//
+//  Hides the static sprites of one world that are outside the camera. The
+//  sprites are bucketed once into a coarse grid by their world bounds; as
+//  the camera moves, only the cells it covers are tested, and work is only
+//  done when the covered cells change, toggling the sprites that came into
+//  or went out of view.
+//
+
+#ifndef __SCENE_CULLER_H__
+#define __SCENE_CULLER_H__
+
+#include <cugl/cugl.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+/** Side of a grid cell, in points */
+#define CULL_CELL           512.0f
+/** How far outside the camera rect a sprite is still drawn, in points */
+#define CULL_MARGIN         128.0f
+
+class SceneCuller {
+private:
+    /** One static sprite */
+    struct Entry {
+        std::shared_ptr<cugl::scene2::SceneNode> node;
+        /** Bounds in world coordinates */
+        cugl::Rect bounds;
+        /** Last `update` that saw the sprite in view */
+        unsigned int seen;
+        bool shown;
+    };
+
+    std::vector<Entry> _entries;
+    /** Sprites overlapping each cell, row by row */
+    std::vector<std::vector<int>> _cells;
+    /** Lower left corner of the grid and its size in cells */
+    cugl::Vec2 _origin;
+    int _cols;
+    int _rows;
+    /** Cells covered by the last update: x0, y0, x1, y1 */
+    int _range[4];
+    /** Sprites currently drawn */
+    std::vector<int> _shown;
+    unsigned int _stamp;
+    bool _built;
+
+    int cellX(float x) const {
+        return std::max(0, std::min(_cols - 1, (int)std::floor((x - _origin.x) / CULL_CELL)));
+    }
+
+    int cellY(float y) const {
+        return std::max(0, std::min(_rows - 1, (int)std::floor((y - _origin.y) / CULL_CELL)));
+    }
+
+public:
+    SceneCuller() : _cols(0), _rows(0), _stamp(0), _built(false) {
+        std::fill(_range, _range + 4, -1);
+    }
+
+    /** Shows every sprite again and forgets them */
+    void clear() {
+        for (auto& e : _entries) {
+            e.node->setVisible(true);
+        }
+        _entries.clear();
+        _cells.clear();
+        _shown.clear();
+        _built = false;
+        std::fill(_range, _range + 4, -1);
+    }
+
+    /**
+     * Adds the visible children of `parent` that are not in `exclude`.
+     * Sprites hidden on purpose, like the obstacle outlines, are left alone.
+     *
+     * @param parent    A node whose children never move
+     * @param exclude   Children that move and must always be drawn
+     */
+    void addChildren(const std::shared_ptr<cugl::scene2::SceneNode>& parent,
+                     const std::vector<cugl::scene2::SceneNode*>& exclude = std::vector<cugl::scene2::SceneNode*>()) {
+        for (auto& child : parent->getChildren()) {
+            if (!child->isVisible() || std::find(exclude.begin(), exclude.end(), child.get()) != exclude.end()) {
+                continue;
+            }
+            cugl::Rect box = child->getBoundingBox();
+            cugl::Vec2 lo = parent->nodeToWorldCoords(box.origin);
+            cugl::Vec2 hi = parent->nodeToWorldCoords(box.origin + cugl::Vec2(box.size.width, box.size.height));
+            cugl::Rect bounds(std::min(lo.x, hi.x), std::min(lo.y, hi.y), std::abs(hi.x - lo.x), std::abs(hi.y - lo.y));
+            Entry entry = { child, bounds, 0, true };
+            _entries.push_back(entry);
+        }
+        _built = false;
+    }
+
+    /** Buckets the sprites; call once every sprite is added */
+    void build() {
+        _cells.clear();
+        _shown.clear();
+        std::fill(_range, _range + 4, -1);
+        if (_entries.empty()) {
+            _cols = _rows = 0;
+            _built = true;
+            return;
+        }
+        cugl::Vec2 lo = _entries[0].bounds.origin;
+        cugl::Vec2 hi = lo;
+        for (auto& e : _entries) {
+            lo.x = std::min(lo.x, e.bounds.origin.x);
+            lo.y = std::min(lo.y, e.bounds.origin.y);
+            hi.x = std::max(hi.x, e.bounds.origin.x + e.bounds.size.width);
+            hi.y = std::max(hi.y, e.bounds.origin.y + e.bounds.size.height);
+        }
+        _origin = lo;
+        _cols = std::max(1, (int)std::ceil((hi.x - lo.x) / CULL_CELL));
+        _rows = std::max(1, (int)std::ceil((hi.y - lo.y) / CULL_CELL));
+        _cells.assign((size_t)_cols * _rows, std::vector<int>());
+        for (int i = 0; i < _entries.size(); i++) {
+            Entry& e = _entries[i];
+            int x1 = cellX(e.bounds.origin.x + e.bounds.size.width);
+            int y1 = cellY(e.bounds.origin.y + e.bounds.size.height);
+            for (int y = cellY(e.bounds.origin.y); y <= y1; y++) {
+                for (int x = cellX(e.bounds.origin.x); x <= x1; x++) {
+                    _cells[(size_t)y * _cols + x].push_back(i);
+                }
+            }
+            // everything starts hidden; the first update shows what is in view
+            e.node->setVisible(false);
+            e.shown = false;
+        }
+        _built = true;
+    }
+
+    /**
+     * Shows the sprites near `view` and hides the ones that left it.
+     *
+     * @param view  The camera rect in world coordinates
+     */
+    void update(const cugl::Rect& view) {
+        if (!_built || _cells.empty()) {
+            return;
+        }
+        cugl::Rect grown(view.origin.x - CULL_MARGIN, view.origin.y - CULL_MARGIN,
+                         view.size.width + 2 * CULL_MARGIN, view.size.height + 2 * CULL_MARGIN);
+        int range[4] = { cellX(grown.origin.x), cellY(grown.origin.y),
+                         cellX(grown.origin.x + grown.size.width), cellY(grown.origin.y + grown.size.height) };
+        if (std::equal(range, range + 4, _range)) {
+            // same cells as last frame, nothing came into view
+            return;
+        }
+        std::copy(range, range + 4, _range);
+
+        // the sprites of the covered cells are in view
+        _stamp += 1;
+        for (int y = range[1]; y <= range[3]; y++) {
+            for (int x = range[0]; x <= range[2]; x++) {
+                for (int i : _cells[(size_t)y * _cols + x]) {
+                    Entry& e = _entries[i];
+                    if (e.seen == _stamp) {
+                        continue;
+                    }
+                    e.seen = _stamp;
+                    if (!e.shown) {
+                        e.shown = true;
+                        e.node->setVisible(true);
+                        _shown.push_back(i);
+                    }
+                }
+            }
+        }
+        // and the ones shown before that were not seen went out of it
+        size_t kept = 0;
+        for (int i : _shown) {
+            Entry& e = _entries[i];
+            if (e.seen == _stamp) {
+                _shown[kept++] = i;
+            }
+            else {
+                e.shown = false;
+                e.node->setVisible(false);
+            }
+        }
+        _shown.resize(kept);
+    }
+
+    /** Shows every sprite, as for a full render; the next update culls again */
+    void showAll() {
+        _shown.clear();
+        for (int i = 0; i < _entries.size(); i++) {
+            _entries[i].node->setVisible(true);
+            _entries[i].shown = true;
+            _shown.push_back(i);
+        }
+        std::fill(_range, _range + 4, -1);
+    }
+
+#pragma mark Statistics
+    /** Returns how many of the static sprites are drawn */
+    int getDrawn() const {
+        return (int)_shown.size();
+    }
+
+    /** Returns how many of the static sprites are hidden */
+    int getCulled() const {
+        return (int)(_entries.size() - _shown.size());
+    }
+};
+
+#endif /* __SCENE_CULLER_H__ */
@@ -0,0 +1,115 @@
+//
+//  TextureTier.h
+//  Tilemap
+//
+//  Picks the texture resolution the game loads at. The largest textures
+//  (the tutorial pages and the character, guard and marker sheets, all
+//  drawn scaled down) have half and quarter resolution copies written by
+//  tools/texture_tiers.py, each set with its own asset directory. At
+//  startup the highest tier whose texture memory fits a share of the
+//  device RAM is chosen, one lower on small displays. A node drawn with a
+//  reduced copy is given back the size of the full texture, so positions,
+//  scales and children stay in full resolution units.
+//
+
+#ifndef __TEXTURE_TIER_H__
+#define __TEXTURE_TIER_H__
+
+#include <cugl/cugl.h>
+#include <string>
+#include <unordered_set>
+
+/** The tier list written by tools/texture_tiers.py */
+#define TIER_MANIFEST       "json/tiers.json"
+/** Share of the device RAM the textures may take */
+#define TIER_RAM_SHARE      0.25f
+/** Below this many display pixels per scene point, full resolution is never shown */
+#define TIER_SMALL_DISPLAY  0.75f
+/** Number of tiers: full, half and quarter resolution */
+#define TIER_COUNT          3
+
+class TextureTier {
+private:
+    /** Index into the tier tables, 0 is full resolution */
+    int _tier;
+    /** Keys of the textures that have reduced copies */
+    std::unordered_set<std::string> _keys;
+
+    TextureTier() : _tier(0) {}
+
+    static const char* name(int tier) {
+        static const char* names[TIER_COUNT] = { "full", "half", "quarter" };
+        return names[tier];
+    }
+
+    static const char* directory(int tier) {
+        static const char* directories[TIER_COUNT] = { "json/assets.json", "json/assets_half.json", "json/assets_quarter.json" };
+        return directories[tier];
+    }
+
+public:
+    static TextureTier& get() {
+        static TextureTier tier;
+        return tier;
+    }
+
+    /**
+     * Chooses the tier for this device.
+     *
+     * @param density   Display pixels per scene point
+     * @param ram       System RAM in MB
+     *
+     * @return the asset directory to load
+     */
+    std::string select(float density, int ram) {
+        _tier = 0;
+        _keys.clear();
+        std::shared_ptr<cugl::JsonReader> reader = cugl::JsonReader::allocWithAsset(TIER_MANIFEST);
+        if (reader == nullptr) {
+            return directory(0);
+        }
+        std::shared_ptr<cugl::JsonValue> json = reader->readJson();
+        reader->close();
+        if (json == nullptr) {
+            return directory(0);
+        }
+
+        std::shared_ptr<cugl::JsonValue> bytes = json->get("bytes");
+        double budget = ram * TIER_RAM_SHARE;
+        if (density < TIER_SMALL_DISPLAY) {
+            _tier = 1;
+        }
+        while (_tier < TIER_COUNT - 1 && bytes->getDouble(name(_tier)) / (1024 * 1024) > budget) {
+            _tier += 1;
+        }
+        if (_tier > 0) {
+            std::shared_ptr<cugl::JsonValue> keys = json->get("textures");
+            for (int i = 0; i < keys->size(); i++) {
+                _keys.insert(keys->get(i)->asString());
+            }
+        }
+        CULog("texture tier %s: %.0f MB of textures, budget %.0f MB, %.2f pixels per point",
+              name(_tier), bytes->getDouble(name(_tier)) / (1024 * 1024), budget, density);
+        return directory(_tier);
+    }
+
+    /** Returns the resolution of the loaded copies against the full textures */
+    float getScale() const {
+        return 1.0f / (1 << _tier);
+    }
+
+    /**
+     * Stretches a node just made from the texture `key` to the size it has
+     * at full resolution. Call before the node is scaled or positioned.
+     *
+     * @param node  A polygon or sprite node drawing the texture
+     * @param key   The texture key
+     */
+    void fit(const std::shared_ptr<cugl::scene2::SceneNode>& node, const std::string& key) const {
+        if (_tier > 0 && _keys.find(key) != _keys.end()) {
+            node->setContentSize(node->getContentSize() / getScale());
+        }
+    }
+};
+
+#endif /* __TEXTURE_TIER_H__ */
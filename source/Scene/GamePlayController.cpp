@@ -19,10 +19,6 @@ using namespace cugl;
 
 GamePlayController::GamePlayController(const Size displaySize, std::shared_ptr<cugl::AssetManager>& assets ):
 _scene(cugl::Scene2::alloc(displaySize)), _other_scene(cugl::Scene2::alloc(displaySize)),  _UI_scene(cugl::Scene2::alloc(displaySize)){
-    //minimap stuff
-    _renderTarget = RenderTarget::alloc((displaySize*1.5).width, (displaySize*1.5).height);
-    _minimapNode = cugl::scene2::PolygonNode::alloc();
-    _minimapChar = cugl::scene2::PolygonNode::alloc();
     added = false;
     _isPanning = false;
     panned = false;
@@ -55,10 +51,14 @@ _scene(cugl::Scene2::alloc(displaySize)), _other_scene(cugl::Scene2::alloc(displ
     
     // Allocate the manager and the actions
     _actions = cugl::scene2::ActionManager::alloc();
+    _animator = SpriteAnimator::alloc();
     _action_world_switch = cugl::scene2::ActionManager::alloc();
     
     // Allocate the camera manager
     _camManager = CameraManager::alloc();
+#ifdef RENDER_STATS_CSV
+    _renderStats.openCSV(Application::get()->getSaveDirectory() + "render_stats.csv");
+#endif
 
 //    _scene->setSize(displaySize*3);
 //    _other_scene->setSize(displaySize*3);
@@ -71,7 +71,9 @@ _scene(cugl::Scene2::alloc(displaySize)), _other_scene(cugl::Scene2::alloc(displ
     _previewNode = cugl::scene2::PolygonNode::alloc();
     _previewBound = cugl::scene2::PathNode::alloc();
 
-    _scene2texture = Scene2Texture::alloc(displaySize*6);
+    _lens.init(PREVIEW_RADIUS);
+    _previewNode->setPolygon(_lens.getShape());
+    _previewNode->setAnchor(Vec2::ANCHOR_CENTER);
 //    _scene->setSize(displaySize *3)
 //    _other_scene->setSize(displaySize *3);
     
@@ -130,8 +132,7 @@ _scene(cugl::Scene2::alloc(displaySize)), _other_scene(cugl::Scene2::alloc(displ
                 AudioEngine::get()->clear("present");
             }
             // restart the game
-            loadLevel();
-            init();
+            restart();
         }
     });
     
@@ -190,8 +191,7 @@ _scene(cugl::Scene2::alloc(displaySize)), _other_scene(cugl::Scene2::alloc(displ
                 AudioEngine::get()->clear("present");
             }
             // restart the game
-            loadLevel();
-            init();
+            restart();
         
         }
     });
@@ -248,6 +248,7 @@ _scene(cugl::Scene2::alloc(displaySize)), _other_scene(cugl::Scene2::alloc(displ
     for (auto name : tutorial_names){
         std::shared_ptr<cugl::scene2::PolygonNode> tutorial_image = std::make_shared<cugl::scene2::PolygonNode>();
         tutorial_image->initWithTexture(_assets->get<Texture>("tutorial_" + name));
+        TextureTier::get().fit(tutorial_image, "tutorial_" + name);
         tutorial_image->setScale(0.75);
         tutorial_image->setAnchor(Vec2(0.5, 0.5));
         tutorial_image->setPosition(Vec2(900,80));
@@ -322,10 +323,12 @@ void GamePlayController::loadLevel(){
     // artifact
     _artifactSet = _pastWorldLevel->getItem();
     _artifactSet->setAction(_actions);
+    _artifactSet->setAnimator(_animator);
     artNum = _artifactSet->getArtNum();
     // resources
     _resourceSet = _pastWorldLevel->getResources();
     _resourceSet->setAction(_actions);
+    _resourceSet->setAnimator(_animator);
     resNum = _resourceSet->getResNum();
     // exit
     _exitSet = _pastWorldLevel->getExit();
@@ -354,29 +357,20 @@ void GamePlayController::loadLevel(){
         addPresentEdge(presentEdges[i].first, presentEdges[i].second);
     }
     
-    _guardSetPast = std::make_unique<GuardSetController>(_assets, _actions, _pastWorld, _obsSetPast, pastMatrix, _pastWorld->getNodes());
-    _guardSetPresent = std::make_unique<GuardSetController>(_assets, _actions, _presentWorld, _obsSetPresent, presentMatrix, _presentWorld->getNodes());
-    
-    // get guard positions
+    // get guard positions, the template every restart of this level uses
     _pastMovingGuardsPos = _pastWorldLevel->getMovingGuardsPos();
     _pastStaticGuardsPos = _pastWorldLevel->getStaticGuardsPos();
     _presentMovingGuardsPos = _presentWorldLevel->getMovingGuardsPos();
     _presentStaticGuardsPos = _presentWorldLevel->getStaticGuardsPos();
-
-    // generate guards in past world
-    generateMovingGuards(_pastMovingGuardsPos, true);
-    generateStaticGuards(_pastStaticGuardsPos, true);
-    
-    // generate guards in present world
-    generateMovingGuards(_presentMovingGuardsPos, false);
-    generateStaticGuards(_presentStaticGuardsPos, false);
+    // the worlds are new, init builds guards for them
+    _guardsBuilt = false;
 
 //    Vec2 start = Vec2(_scene->getSize().width *.85, _scene->getSize().height *.15);
     
 //    Vec2 start = Vec2(0,0);
     Vec2 start = _pastWorldLevel->getCharacterPos();
 
-    _character = make_unique<CharacterController>(start, _actions, _assets);
+    _character = make_unique<CharacterController>(start, _actions, _animator, _assets);
 
     // change label with level
     auto pause_label  = std::dynamic_pointer_cast<scene2::Label>(_assets->get<scene2::SceneNode>("pause_title"));
@@ -384,6 +378,14 @@ void GamePlayController::loadLevel(){
     
 }
 
+// restart the current level from what is already loaded
+void GamePlayController::restart(){
+    // collected resources are shared with the level template, put them back
+    _pastWorldLevel->getResources()->restore();
+    _pastWorldLevel->getItem()->restore();
+    init();
+}
+
 // init assets and all scenegraph when restart
 void GamePlayController::init(){
     // tutorial 1.1
@@ -404,24 +406,26 @@ void GamePlayController::init(){
     _camManager->dispose();
     
     // remove everything first
+    _cullPast.clear();
+    _cullPresent.clear();
     _UI_scene->removeAllChildren();
     _scene->removeAllChildren();
     _ordered_root->removeAllChildren();
-    _scene2texture->removeAllChildren();
+    _lens.getScene()->removeAllChildren();
     _other_scene->removeAllChildren();
     _other_ordered_root->removeAllChildren();
     
     _pastWorld->addChildTo(_scene);
-    std::shared_ptr<cugl::scene2::OrderedNode> shadowRootPast = cugl::scene2::OrderedNode::allocWithOrder(cugl::scene2::OrderedNode::Order::DESCEND);
-    _scene->addChild(shadowRootPast);
-    _shadowSetPast->addChildTo(shadowRootPast);
+    _shadowRootPast = cugl::scene2::OrderedNode::allocWithOrder(cugl::scene2::OrderedNode::Order::DESCEND);
+    _scene->addChild(_shadowRootPast);
+    _shadowSetPast->addChildTo(_shadowRootPast);
 
     _scene->addChild(_ordered_root);
     
     _presentWorld->addChildTo(_other_scene);
-    std::shared_ptr<cugl::scene2::OrderedNode> shadowRootPresent =  cugl::scene2::OrderedNode::allocWithOrder(cugl::scene2::OrderedNode::Order::DESCEND);
-    _other_scene->addChild(shadowRootPresent);
-    _shadowSetPresent->addChildTo(shadowRootPresent);
+    _shadowRootPresent =  cugl::scene2::OrderedNode::allocWithOrder(cugl::scene2::OrderedNode::Order::DESCEND);
+    _other_scene->addChild(_shadowRootPresent);
+    _shadowSetPresent->addChildTo(_shadowRootPresent);
     _other_scene->addChild(_other_ordered_root);
 
     // for two world switch animation
@@ -466,24 +470,26 @@ void GamePlayController::init(){
     
     Vec2 start = _pastWorldLevel->getCharacterPos();
 
-    _character = make_unique<CharacterController>(start, _actions, _assets);
+    _character = make_unique<CharacterController>(start, _actions, _animator, _assets);
     //_character->addChildTo(_scene);
     _character->addChildTo(_ordered_root);
     
-    _guardSetPast = std::make_unique<GuardSetController>(_assets, _actions, _pastWorld, _obsSetPast, pastMatrix, _pastWorld->getNodes());
-    _guardSetPresent = std::make_unique<GuardSetController>(_assets, _actions, _presentWorld, _obsSetPresent, presentMatrix, _presentWorld->getNodes());
-    
-    _guardSetPast->clearSet();
-    _guardSetPresent->clearSet();
-    
-    // all guards are init in _guardSet
-    // generate guards in past world
-    generateMovingGuards(_pastMovingGuardsPos, true);
-    generateStaticGuards(_pastStaticGuardsPos, true);
-    
-    // generate guards in present world
-    generateMovingGuards(_presentMovingGuardsPos, false);
-    generateStaticGuards(_presentStaticGuardsPos, false);
+    if (_guardsBuilt) {
+        // restart: the guards of this level go back to their posts in place
+        _guardSetPast->reset();
+        _guardSetPresent->reset();
+        _guardSetPast->addChildTo(_ordered_root);
+        _guardSetPresent->addChildTo(_other_ordered_root);
+        // the player starts in the past, the present guards run reduced
+        _guardSetPresent->sleep();
+        _guardSetPast->startTrace();
+        _guardSetPresent->startTrace();
+    }
+    else {
+        buildGuards();
+    }
+    assignStaticPriorities();
+    buildCulling();
 
 
     _path = make_unique<PathController>(_assets);
@@ -493,6 +499,12 @@ void GamePlayController::init(){
     
     
     _UI_scene->addChild(_button_layer);
+    // baked on the first render, once every sprite is in place
+    _minimap.init(_pastWorld->getSize());
+    _UI_scene->addChild(_minimap.getNode());
+#ifdef RENDER_STATS_OVERLAY
+    _renderStats.showOverlay(_assets->get<Font>("sans"), _UI_scene);
+#endif
     
     
     //_ordered_root->addChild(_button_layer);
@@ -529,6 +541,18 @@ void GamePlayController::init(){
     
     _tappingPause = false;
     
+    // build every sprite clip now, gameplay should never add one
+    AnimationClipSet::guard();
+    AnimationClipSet::character();
+    AnimationClipSet::item();
+    // guards, the character and the items registered their tracks when they
+    // were built or given the animator; removing them must not allocate
+    _animator->reserve();
+    _animAllocations = _animator->getAllocations();
+
+#ifdef ANIMATION_BENCHMARK
+    runAnimationBenchmark(_assets->get<Texture>("clock_Anim"), 500);
+#endif
 }
 
 void GamePlayController::update(float dt){
@@ -577,6 +601,9 @@ void GamePlayController::update(float dt){
             _activeMap = "presentWorld";
             _pastWorld->setActive(false);
             _presentWorld->setActive(true);
+            _guardSetPast->sleep();
+            _guardSetPresent->wake();
+            _guardSetPresent->makeNoise(_character->getNodePosition(), SOUND_SWITCH);
             
             _other_cam->setPosition(_cam->getPosition());
             _UI_cam->setPosition(_cam->getPosition());
@@ -594,6 +621,9 @@ void GamePlayController::update(float dt){
             _activeMap = "pastWorld";
             _pastWorld->setActive(true);
             _presentWorld->setActive(false);
+            _guardSetPresent->sleep();
+            _guardSetPast->wake();
+            _guardSetPast->makeNoise(_character->getNodePosition(), SOUND_SWITCH);
             _cam->setPosition(_other_cam->getPosition());
             _UI_cam->setPosition(_other_cam->getPosition());
 
@@ -703,9 +733,10 @@ void GamePlayController::update(float dt){
                 for (int i = 0; i < _children.size(); i++){
                     auto tempChild = _children[i];
                     _other_scene->removeChild(_children[i]);
-                    _scene2texture->addChild(tempChild);
+                    _lens.getScene()->addChild(tempChild);
                 }
-                _texture = _scene2texture->getTexture();
+                _lens.invalidate();
+                _texture = _lens.getTexture();
                 _previewNode->setTexture(_texture);
                 auto c = _previewNode->getColor();
                 _previewNode->setColor(Color4(c.r, c.g, c.b, 235));
@@ -721,9 +752,10 @@ void GamePlayController::update(float dt){
                 for (int i = 0; i < _children.size(); i++){
                     auto tempChild = _children[i];
                     _scene->removeChild(_children[i]);
-                    _scene2texture->addChild(tempChild);
+                    _lens.getScene()->addChild(tempChild);
                 }
-                _texture = _scene2texture->getTexture();
+                _lens.invalidate();
+                _texture = _lens.getTexture();
                 _previewNode->setTexture(_texture);
                 _previewNode->setVisible(false);
                 _other_scene->addChildWithName(_previewNode, "preview");
@@ -930,10 +962,10 @@ void GamePlayController::update(float dt){
         
         //finish previewing
         if (_activeMap == "pastWorld"){
-            auto _children = _scene2texture->getChildren();
+            auto _children = _lens.getScene()->getChildren();
             for (int i = 0; i < _children.size(); i++){
                 auto tempChild = _children[i];
-                _scene2texture->removeChild(_children[i]);
+                _lens.getScene()->removeChild(_children[i]);
                 _other_scene->addChild(tempChild);
             }
             _scene->removeChildByName("preview");
@@ -957,11 +989,9 @@ void GamePlayController::update(float dt){
             input_posi = _other_scene->screenToWorldCoords(input_posi);
         }
         
-        _previewNode->setAnchor(Vec2::ANCHOR_CENTER);
-        PolyFactory polyFact = PolyFactory();
-        Poly2 circle = polyFact.makeCircle(input_posi + Vec2(0, PREVIEW_RADIUS), PREVIEW_RADIUS);
-        _previewNode->setPolygon(circle);
+        // the lens polygon is fixed, only the node and the lens camera move
         _previewNode->setPosition(input_posi + Vec2(0,PREVIEW_RADIUS));
+        _lens.moveTo(_previewNode->getPosition());
         
         _previewBound->setAnchor(Vec2::ANCHOR_CENTER);
         PathFactory pathFact = PathFactory();
@@ -1012,7 +1042,7 @@ void GamePlayController::update(float dt){
         
     }
 
-    if (!_actions->isActive("moving") && _actions->isActive("character_animation")) {
+    if (!_actions->isActive("moving") && _character->isAnimating()) {
         _character->stopAnimation();
     }
 
@@ -1040,6 +1070,7 @@ void GamePlayController::update(float dt){
                         
                     }
                 }
+                _guardSetPast->makeNoise(_character->getNodePosition(), SOUND_PICKUP);
                 // make the artifact disappear and remove from set
                 _artifactSet->remove_this(i, _ordered_root);
                 break;
@@ -1055,6 +1086,7 @@ void GamePlayController::update(float dt){
                     AudioEngine::get()->play("resource", _collectResourceSound, false, _collectResourceSound->getVolume(), true);
                     _character->addRes();
                 }
+                _guardSetPast->makeNoise(_character->getNodePosition(), SOUND_PICKUP);
                 // make the artifact disappear and remove from set
                 _resourceSet->remove_this(i, _ordered_root);
                 break;
@@ -1064,8 +1096,49 @@ void GamePlayController::update(float dt){
     }
 
 #pragma mark Guard Methods
-    _guardSetPast->patrol(_character->getNodePosition(), _character->getAngle(), _scene, "past");
-    _guardSetPresent->patrol(_character->getNodePosition(), _character->getAngle(), _other_scene, "present");
+    // animation and guard effects only run near the camera, and inside the
+    // lens while previewing
+    Rect animated = getCameraRect();
+    if (_isPreviewing) {
+        animated.merge(_lens.getBounds());
+    }
+    _animator->setView(animated);
+    (_activeMap == "pastWorld" ? _guardSetPast : _guardSetPresent)->setView(animated);
+
+    // footsteps while walking, heard along the nav graph of the current world
+    if (_actions->isActive("moving")) {
+        _footstepTimer -= dt;
+        if (_footstepTimer <= 0) {
+            if (_activeMap == "pastWorld") {
+                _guardSetPast->makeNoise(_character->getNodePosition(), SOUND_FOOTSTEP);
+            }
+            else {
+                _guardSetPresent->makeNoise(_character->getNodePosition(), SOUND_FOOTSTEP);
+            }
+            _footstepTimer = SOUND_STEP_INTERVAL;
+        }
+    }
+    else {
+        _footstepTimer = 0;
+    }
+
+    // where the character is headed, so guards that see it can cut it off
+    std::vector<Vec2> ahead = _path->getPath();
+    if (_actions->isActive("moving")) {
+        ahead.insert(ahead.begin(), _moveTo->getTarget());
+    }
+
+    // only the world the player is in gets the full simulation
+    if (_activeMap == "pastWorld") {
+        _guardSetPast->setPlayerMotion(ahead, ACTIONDURATION);
+        _guardSetPast->patrol(dt, _character->getNodePosition(), _character->getAngle(), _scene);
+        _guardSetPresent->updateInactive(dt, _isPreviewing);
+    }
+    else {
+        _guardSetPresent->setPlayerMotion(ahead, ACTIONDURATION);
+        _guardSetPresent->patrol(dt, _character->getNodePosition(), _character->getAngle(), _other_scene);
+        _guardSetPast->updateInactive(dt, _isPreviewing);
+    }
     // if collide with guard
     if(_activeMap == "pastWorld"){
         for(int i=0; i<_guardSetPast->_guardSet.size(); i++){
@@ -1104,13 +1177,44 @@ void GamePlayController::update(float dt){
         
     }
     
+    if (_animator->getAllocations() != _animAllocations) {
+        CULog("sprite animator allocated during gameplay: %d", _animator->getAllocations() - _animAllocations);
+        _animAllocations = _animator->getAllocations();
+    }
+
     // Animate
     _actions->update(dt);
+    _animator->update(dt);
     _camManager->update(dt);
     
+    // both worlds follow the same camera; the other one also shows in the
+    // lens, which can reach well past the top of the screen
+    Rect view = getCameraRect();
+    Rect other = view;
+    if (_isPreviewing) {
+        other.merge(_lens.getBounds());
+    }
+    _cullPast.update(_activeMap == "pastWorld" ? view : other);
+    _cullPresent.update(_activeMap == "pastWorld" ? other : view);
+    
+    if (_isPreviewing) {
+        // the lens renders again when the guards of the other world move;
+        // items are only collected in the active world
+        _movers.clear();
+        GuardSetController* otherGuards = _activeMap == "pastWorld" ? _guardSetPresent.get() : _guardSetPast.get();
+        otherGuards->collectNodes(_movers);
+        float signature = 0;
+        for (int i = 0; i < _movers.size(); i++) {
+            Vec2 p = _movers[i]->getPosition();
+            signature += p.x * (i + 1) + p.y * (i + 2);
+        }
+        _lens.update(signature, dt);
+    }
+    
     // the camera is moving smoothly, but the UI only set its movement per frame
     
     _button_layer->setPosition(_UI_cam->getPosition() - Vec2(900, 70));
+    updateMinimap();
     
     // update render priority
     updateRenderPriority();
@@ -1135,6 +1239,43 @@ void GamePlayController::update(float dt){
         }
     }
 
+    void GamePlayController::buildGuards() {
+        _guardSetPast = std::make_unique<GuardSetController>(_assets, _actions, _animator, _pastWorld, _obsSetPast, pastMatrix, _pastWorld->getNodes());
+        _guardSetPresent = std::make_unique<GuardSetController>(_assets, _actions, _animator, _presentWorld, _obsSetPresent, presentMatrix, _presentWorld->getNodes());
+        // route lookups instead of searches on levels small enough for a table
+        _guardSetPast->prepareNextHops(nextHopPath(true));
+        _guardSetPresent->prepareNextHops(nextHopPath(false));
+
+        // generate guards in past world
+        generateMovingGuards(_pastMovingGuardsPos, true);
+        generateStaticGuards(_pastStaticGuardsPos, true);
+
+        // generate guards in present world
+        generateMovingGuards(_presentMovingGuardsPos, false);
+        generateStaticGuards(_presentStaticGuardsPos, false);
+        // the player starts in the past, the present guards run reduced
+        _guardSetPresent->sleep();
+        _guardSetPast->startTrace();
+        _guardSetPresent->startTrace();
+        _guardsBuilt = true;
+#ifdef GUARD_REPLAY
+        // re-run the last dumped sessions, then start the level as usual
+        GuardTrace recorded;
+        if (recorded.load(guardTracePath(true))) {
+            _guardSetPast->replay(recorded);
+        }
+        if (recorded.load(guardTracePath(false))) {
+            _guardSetPresent->replay(recorded);
+        }
+        _actions->dispose();
+        _guardSetPast->reset();
+        _guardSetPresent->reset();
+        _guardSetPresent->sleep();
+        _guardSetPast->startTrace();
+        _guardSetPresent->startTrace();
+#endif
+    }
+
     void GamePlayController::generateStaticGuards(std::vector<std::vector<int>> staticGuardsPos, bool isPast) {
         for (int i = 0; i < staticGuardsPos.size(); i++) {
             int x = staticGuardsPos[i][0];
@@ -1150,7 +1291,16 @@ void GamePlayController::update(float dt){
 
     
     void GamePlayController::render(std::shared_ptr<SpriteBatch>& batch){
+#ifdef TILE_CHUNK_REPORT
+        auto renderStart = std::chrono::steady_clock::now();
+#endif
+        if (!_minimap.isBaked()) {
+            bakeMinimap(batch);
+        }
 
+#ifdef RENDER_STATS
+        _renderStats.beginPass();
+#endif
         if (_activeMap == "pastWorld"){
             _scene->render(batch);
         }
@@ -1158,7 +1308,28 @@ void GamePlayController::update(float dt){
         else{
             _other_scene->render(batch);
         }
-        _scene2texture->render(batch);
+#ifdef RENDER_STATS
+        _renderStats.endPass(RENDER_PASS_WORLD, _activeMap == "pastWorld" ? _scene : _other_scene, batch);
+        _renderStats.beginPass();
+#endif
+        if (_isPreviewing && _lens.render(batch)) {
+#ifdef RENDER_STATS
+            _renderStats.endPass(RENDER_PASS_LENS, _lens.getScene(), batch);
+#endif
+        }
+        
+#ifdef TILE_CHUNK_REPORT
+        _reportTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+        _reportFrames += 1;
+        if (_reportFrames == TILE_CHUNK_REPORT_FRAMES) {
+            TilemapController* world = _activeMap == "pastWorld" ? _pastWorld.get() : _presentWorld.get();
+            SceneCuller& cull = _activeMap == "pastWorld" ? _cullPast : _cullPresent;
+            CULog("tilemap %d nodes, %d static sprites drawn, %d culled, render %.3f ms per frame over %d frames",
+                  world->getNodeCount(), cull.getDrawn(), cull.getCulled(), _reportTime / _reportFrames, _reportFrames);
+            _reportFrames = 0;
+            _reportTime = 0;
+        }
+#endif
         
         std::chrono::duration<double> elapsed_seconds = _previewEnd - _previewStart;
         
@@ -1177,9 +1348,15 @@ void GamePlayController::update(float dt){
             _previewStart = std::chrono::steady_clock::now();
         }
         
+#ifdef RENDER_STATS
+        Size view = _UI_cam->getViewport().size / _UI_cam->getZoom();
+        _renderStats.setCorner((Vec2)_UI_cam->getPosition() + Vec2(-view.width / 2, view.height / 2));
+        _renderStats.beginPass();
+#endif
         _UI_scene->render(batch);
-        
-        
-
+#ifdef RENDER_STATS
+        _renderStats.endPass(RENDER_PASS_UI, _UI_scene, batch);
+        _renderStats.endFrame();
+#endif
     }
     
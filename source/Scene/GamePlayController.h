@@ -14,6 +14,13 @@ using namespace std;
 #include <Camera/CameraMove.h>
 #include <GuardSet/GuardSetController.h>
 #include <ItemSet/ItemSetController.h>
+#include <Animation/AnimationBenchmark.h>
+#include <Render/DepthSorter.h>
+#include <Render/SceneCuller.h>
+#include <Render/PreviewLens.h>
+#include <Render/Minimap.h>
+#include <Render/TextureTier.h>
+#include <Render/RenderStats.h>
 #include "LevelController.h"
 #include <common.h>
 #include <map> 
@@ -32,6 +39,18 @@ private:
     
     std::shared_ptr<cugl::scene2::OrderedNode> _other_ordered_root;
     
+    /** Y-sorting of the moving sprites in each ordered root */
+    DepthSorter _depthPast;
+    DepthSorter _depthPresent;
+    /** Moving sprites of one world, refilled every frame */
+    std::vector<cugl::scene2::SceneNode*> _movers;
+    /** Shadows of each world, drawn under everything in the ordered roots */
+    std::shared_ptr<cugl::scene2::OrderedNode> _shadowRootPast;
+    std::shared_ptr<cugl::scene2::OrderedNode> _shadowRootPresent;
+    /** Hide the static sprites of each world outside the camera */
+    SceneCuller _cullPast;
+    SceneCuller _cullPresent;
+    
 
     /** The current tile map template (for regeneration) */
     int _template;
@@ -104,6 +123,8 @@ public:
 
     /** Manager to process the animation actions */
     std::shared_ptr<cugl::scene2::ActionManager> _actions;
+    /** Ticker for the looping sprite animations */
+    std::shared_ptr<SpriteAnimator> _animator;
     std::shared_ptr<cugl::scene2::MoveTo> _moveTo;
 
     /**adjacency matrix*/
@@ -129,12 +150,11 @@ public:
     bool _isPreviewing;
     std::shared_ptr<cugl::scene2::PolygonNode> _previewNode;
     std::shared_ptr<cugl::scene2::PathNode> _previewBound;
-    std::shared_ptr<Scene2Texture> _scene2texture;
+    /** Render target of the other-world preview */
+    PreviewLens _lens;
     std::shared_ptr<Texture> _texture;
-    std::shared_ptr<cugl::scene2::PolygonNode> _minimapNode;
-    std::shared_ptr<cugl::scene2::PolygonNode> _minimapChar;
-    std::shared_ptr<cugl::RenderTarget> _renderTarget;
-    std::shared_ptr<Texture> _minimapTexture;
+    /** Corner map of the active world */
+    Minimap _minimap;
     std::chrono::steady_clock::time_point _previewStart;
     std::chrono::steady_clock::time_point _previewEnd;
     bool added;
@@ -144,6 +164,20 @@ public:
     // two_world switch
 
     bool _cantSwitch = false;
+    
+    /** time until the walking character makes its next footstep noise */
+    float _footstepTimer = 0;
+    
+    /** sprite animator allocations when the level finished loading */
+    int _animAllocations = 0;
+    
+    /** frames and milliseconds rendered since the last tilemap report */
+    int _reportFrames = 0;
+    double _reportTime = 0;
+#ifdef RENDER_STATS
+    /** draw calls, vertices and texture switches of each render pass */
+    RenderStats _renderStats;
+#endif
     // if two-world switch is in progress
     bool _isSwitching;
     // first half: collapse
@@ -162,6 +196,8 @@ public:
 
     std::vector<std::vector<cugl::Vec2>> _presentMovingGuardsPos;
     std::vector<std::vector<int>> _presentStaticGuardsPos;
+    /** Whether the guard sets were built for the loaded level and can be reset */
+    bool _guardsBuilt = false;
 
     // sounds
     std::shared_ptr<cugl::Sound> _collectArtifactSound;
@@ -193,6 +229,9 @@ public:
      * Init the GameplayScene when start, mostly do scenegraph arrangement
      */
     void init();
+
+    /** Restarts the loaded level without reading it again */
+    void restart();
     
     
     /**
@@ -288,8 +327,32 @@ public:
         presentMatrix[j][i] = true;
     }
 
+    /** Where the baked next-hop table of a world of this level is stored */
+    std::string nextHopPath(bool isPast){
+        return Application::get()->getSaveDirectory() + "level-" + std::to_string(level) + (isPast ? "-past.hops" : "-present.hops");
+    }
+
+    /** Where the guard trace of a world is dumped and replayed from */
+    std::string guardTracePath(bool isPast){
+        return Application::get()->getSaveDirectory() + (isPast ? "guard_trace_past.bin" : "guard_trace_present.bin");
+    }
+
+    /** Logs how much guard search work the path caches saved this level */
+    void logPathCaches(){
+        PathCache& past = _guardSetPast->getPathCache();
+        PathCache& present = _guardSetPresent->getPathCache();
+        CULog("path cache hit rate: past %.0f%% of %ld, present %.0f%% of %ld",
+              past.getHitRate() * 100, past.getHits() + past.getMisses(),
+              present.getHitRate() * 100, present.getHits() + present.getMisses());
+    }
+
     void failTerminate(){
+        logPathCaches();
         _tutorial_name = "";
+#ifdef GUARD_TRACE
+        _guardSetPast->getTrace().dump(guardTracePath(true));
+        _guardSetPresent->getTrace().dump(guardTracePath(false));
+#endif
         AudioEngine::get()->play("lost", _loseSound, false, _loseSound->getVolume(), true);
         if (_activeMap == "pastWorld"){
             _scene->addChild(_fail_layer);
@@ -305,6 +368,7 @@ public:
     }
     
     void completeTerminate(){
+        logPathCaches();
         _tutorial_name = "";
         AudioEngine::get()->play("win", _winSound, false, _winSound->getVolume(), true);
         if (_activeMap == "pastWorld"){
@@ -336,12 +400,29 @@ public:
         _pause_exit->activate();
     }
     
+    /** Returns the part of the active world the camera shows */
+    Rect getCameraRect(){
+        std::shared_ptr<Camera> cam = _activeMap == "pastWorld" ? _cam : _other_cam;
+        Size size = cam->getViewport().size;
+        float zoom = cam->getZoom();
+        Vec3 pos = cam->getPosition();
+        return Rect(pos.x - size.width / (2 * zoom), pos.y - size.height / (2 * zoom),
+                    size.width / zoom, size.height / zoom);
+    }
+    
+    /** Builds both guard sets from the guard template of the loaded level */
+    void buildGuards();
+
     // called when scene becomes active or inactive
     void generateMovingGuards(std::vector<std::vector<cugl::Vec2>> movingGuardsPos, bool isPast);
     void generateStaticGuards(std::vector<std::vector<int>> staticGuardsPos, bool isPast);
 
     
-    void updateRenderPriority(){
+    /**
+     * Gives every sprite its priority once the level is built. Only the
+     * character and the guards move, so everything else keeps these.
+     */
+    void assignStaticPriorities(){
         // both orderedRoot
         //_pastWorld->setPriority(1000);
         _artifactSet->updatePriority();
@@ -358,6 +439,101 @@ public:
         _wallSetPresent->updatePriority();
         _shadowSetPresent->updatePriority();
         _guardSetPresent->updatePriority();
+        
+        _movers.clear();
+        _movers.push_back(_character->getNode());
+        _guardSetPast->collectNodes(_movers);
+        _guardSetPresent->collectNodes(_movers);
+        _depthPast.freeze(_ordered_root, _movers);
+        _depthPresent.freeze(_other_ordered_root, _movers);
+    }
+    
+    /**
+     * Indexes the tiles, shadows and static sprites of both worlds for
+     * culling. Call after `assignStaticPriorities`, which lists the movers.
+     */
+    void buildCulling(){
+        _cullPast.clear();
+        _cullPast.addChildren(_pastWorld->getNode());
+        _cullPast.addChildren(_shadowRootPast);
+        _cullPast.addChildren(_ordered_root, _movers);
+        _cullPast.build();
+        
+        _cullPresent.clear();
+        _cullPresent.addChildren(_presentWorld->getNode());
+        _cullPresent.addChildren(_shadowRootPresent);
+        _cullPresent.addChildren(_other_ordered_root, _movers);
+        _cullPresent.build();
+    }
+    
+    /** Re-sorts the character and the guards against the static sprites */
+    void updateRenderPriority(){
+        bool past = _activeMap == "pastWorld";
+        _movers.clear();
+        if (past) {
+            _movers.push_back(_character->getNode());
+        }
+        _guardSetPast->collectNodes(_movers);
+        _depthPast.update(_movers);
+        
+        _movers.clear();
+        if (!past) {
+            _movers.push_back(_character->getNode());
+        }
+        _guardSetPresent->collectNodes(_movers);
+        _depthPresent.update(_movers);
+    }
+    
+    /**
+     * Renders the static layers of both worlds into the minimap. Everything
+     * that moves or can be collected is hidden for the bake and drawn as a
+     * marker instead.
+     */
+    void bakeMinimap(std::shared_ptr<SpriteBatch>& batch){
+        _cullPast.showAll();
+        _cullPresent.showAll();
+        _movers.clear();
+        _movers.push_back(_character->getNode());
+        _guardSetPast->collectNodes(_movers);
+        _guardSetPresent->collectNodes(_movers);
+        std::vector<bool> shown;
+        for (auto node : _movers) {
+            shown.push_back(node->isVisible());
+            node->setVisible(false);
+        }
+        _artifactSet->setVisibility(false);
+        
+        _minimap.bake(0, _scene, batch);
+        _minimap.bake(1, _other_scene, batch);
+        
+        _artifactSet->setVisibility(true);
+        for (int i = 0; i < _movers.size(); i++) {
+            _movers[i]->setVisible(shown[i]);
+        }
+    }
+    
+    /** Moves the minimap markers and keeps the map in the screen corner */
+    void updateMinimap(){
+        bool past = _activeMap == "pastWorld";
+        _minimap.showWorld(past ? 0 : 1);
+        _minimap.beginMarkers();
+        _movers.clear();
+        (past ? _guardSetPast : _guardSetPresent)->collectNodes(_movers);
+        for (auto node : _movers) {
+            _minimap.mark(node->getPosition(), Color4::RED);
+        }
+        if (past) {
+            for (auto& item : _artifactSet->_itemSet) {
+                if (item->isArtifact()) {
+                    _minimap.mark(item->getNodePosition(), Color4::YELLOW);
+                }
+            }
+        }
+        _minimap.mark(_character->getNodePosition(), Color4::WHITE);
+        _minimap.endMarkers();
+        
+        Size view = _UI_cam->getViewport().size / _UI_cam->getZoom();
+        _minimap.setCorner((Vec2)_UI_cam->getPosition() + Vec2(view.width / 2, -view.height / 2));
     }
     
     void updateInventoryPanel(){
@@ -407,10 +583,10 @@ public:
     }
     
     void stopCharacter(){
-        auto _children = _scene2texture->getChildren();
+        auto _children = _lens.getScene()->getChildren();
         for (int i = 0; i < _children.size(); i++){
             auto tempChild = _children[i];
-            _scene2texture->removeChild(_children[i]);
+            _lens.getScene()->removeChild(_children[i]);
             _scene->addChild(tempChild);
         }
         _other_scene->removeChildByName("preview");
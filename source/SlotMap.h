@@ -0,0 +1,116 @@
+//
+//  SlotMap.h
+//  Tilemap
+//
+//  Generational handles for guards and items. Slots are recycled through a
+//  free list, so insert and erase are O(1) and long sessions or generated
+//  levels never run out of ids; the generation makes stale handles miss.
+//
+
+#ifndef __SLOT_MAP_H__
+#define __SLOT_MAP_H__
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/** A stable reference to a slot-map entry */
+struct SlotHandle {
+    /** Slot the entry lives in */
+    uint32_t index;
+    /** How many times the slot had been freed when the handle was issued */
+    uint32_t generation;
+
+    SlotHandle() : index(UINT32_MAX), generation(0) {}
+    SlotHandle(uint32_t i, uint32_t g) : index(i), generation(g) {}
+
+    bool isNull() const {
+        return index == UINT32_MAX;
+    }
+
+    bool operator==(const SlotHandle& other) const {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const SlotHandle& other) const {
+        return !(*this == other);
+    }
+
+    /** Returns a short string unique to this handle, for action keys */
+    std::string key() const {
+        return std::to_string(index) + "g" + std::to_string(generation);
+    }
+};
+
+template <typename T>
+class SlotMap {
+private:
+    /** Value stored in each slot */
+    std::vector<T> _values;
+    /** Current generation of each slot */
+    std::vector<uint32_t> _generations;
+    /** Whether each slot holds a live entry */
+    std::vector<bool> _live;
+    /** Slots ready for reuse */
+    std::vector<uint32_t> _free;
+    /** Number of live entries */
+    size_t _size;
+
+public:
+    SlotMap() : _size(0) {}
+
+    /** Stores `value` and returns its handle */
+    SlotHandle insert(const T& value) {
+        uint32_t index;
+        if (!_free.empty()) {
+            index = _free.back();
+            _free.pop_back();
+            _values[index] = value;
+        }
+        else {
+            index = (uint32_t)_values.size();
+            _values.push_back(value);
+            _generations.push_back(0);
+            _live.push_back(false);
+        }
+        _live[index] = true;
+        _size += 1;
+        return SlotHandle(index, _generations[index]);
+    }
+
+    /** Returns whether `handle` still refers to a live entry */
+    bool contains(const SlotHandle& handle) const {
+        return handle.index < _values.size() && _live[handle.index]
+            && _generations[handle.index] == handle.generation;
+    }
+
+    /** Returns the entry for `handle`, or nullptr if it was erased */
+    T* get(const SlotHandle& handle) {
+        return contains(handle) ? &_values[handle.index] : nullptr;
+    }
+
+    /** Frees the slot of `handle`; later lookups with it return nullptr */
+    void erase(const SlotHandle& handle) {
+        if (!contains(handle)) {
+            return;
+        }
+        _live[handle.index] = false;
+        _generations[handle.index] += 1;
+        _values[handle.index] = T();
+        _free.push_back(handle.index);
+        _size -= 1;
+    }
+
+    /** Frees every slot, invalidating all outstanding handles */
+    void clear() {
+        for (uint32_t i = 0; i < _values.size(); i++) {
+            erase(SlotHandle(i, _generations[i]));
+        }
+    }
+
+    size_t size() const {
+        return _size;
+    }
+};
+
+#endif /* __SLOT_MAP_H__ */
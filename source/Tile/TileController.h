@@ -135,6 +135,11 @@ public:
         return _view->getPos();
     }
     
+    /** Returns the bottom left corner of the tile in the tilemap */
+    Vec2 getLocalPosition(){
+        return _model->getPosition();
+    }
+    
     Vec2 getSize(){
         return _model->getSize();
     }
@@ -100,6 +100,11 @@ public:
         return _textureKey;
     }
     
+    /** Returns the bottom left corner of the tile in the tilemap */
+    Vec2 getPosition(){
+        return _position;
+    }
+    
     Size getSize(){
         return _size;
     }
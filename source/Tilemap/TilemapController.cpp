@@ -105,6 +105,10 @@ void TilemapController::addTile2(int col, int row, int height, int totalHeight,
 };
 
 void TilemapController::setTexture(const std::shared_ptr<cugl::AssetManager>& assets){
+#ifdef TILE_CHUNK_BAKING
+    bakeChunks(assets);
+    return;
+#endif
     for(auto& tile_vec : _tilemap){
         for(auto& tile : tile_vec){
             if(tile != nullptr){
@@ -117,6 +121,113 @@ void TilemapController::setTexture(const std::shared_ptr<cugl::AssetManager>& as
     }
 }
 
+/**
+ * Merges the floor tiles into one mesh per TILE_CHUNK_SIZE square chunk
+ * and tile texture.
+ *
+ * A tile texture is drawn centered on the corner of its tile, as a child
+ * of the tile node. Every quad of a chunk mesh sits on a multiple of the
+ * texture size, so the repeating texture lines up with the tiles it
+ * replaces.
+ *
+ * @param assets    The assets the tile textures come from
+ */
+void TilemapController::bakeChunks(const std::shared_ptr<cugl::AssetManager>& assets) {
+    for(auto& chunk : _chunks){
+        _view->getNode()->removeChild(chunk);
+    }
+    _chunks.clear();
+    _unbaked = 0;
+    
+    int tiles = 0;
+    int rows = (int)_tilemap.size();
+    int cols = rows > 0 ? (int)_tilemap[0].size() : 0;
+    for(int r0 = 0; r0 < rows; r0 += TILE_CHUNK_SIZE){
+        for(int c0 = 0; c0 < cols; c0 += TILE_CHUNK_SIZE){
+            // tiles of this chunk by texture
+            std::map<std::string, std::vector<TileController*>> groups;
+            for(int r = r0; r < std::min(r0 + TILE_CHUNK_SIZE, rows); r++){
+                for(int c = c0; c < std::min(c0 + TILE_CHUNK_SIZE, cols); c++){
+                    auto& tile = _tilemap[r][c];
+                    if(tile == nullptr || tile->getTextureKey() == ""){
+                        continue;
+                    }
+                    tiles += 1;
+                    std::string key = tile->getTextureKey();
+                    std::shared_ptr<Texture> texture = assets->get<Texture>(key);
+                    // an atlas region cannot repeat across a chunk
+                    if(texture == nullptr || texture->isSubTexture()){
+                        tile->setTexture(assets, key);
+                        _unbaked += 1;
+                        continue;
+                    }
+                    groups[key].push_back(tile.get());
+                }
+            }
+            
+            for(auto& group : groups){
+                std::shared_ptr<Texture> texture = assets->get<Texture>(group.first);
+                Size size = texture->getSize();
+                
+                Vec2 origin = group.second[0]->getLocalPosition();
+                for(auto& tile : group.second){
+                    origin.x = std::min(origin.x, tile->getLocalPosition().x);
+                    origin.y = std::min(origin.y, tile->getLocalPosition().y);
+                }
+                Poly2 mesh;
+                for(auto& tile : group.second){
+                    Vec2 p = tile->getLocalPosition() - origin;
+                    // the texture is drawn at its own size, which need not be
+                    // the tile size; off its grid it would not line up
+                    if(std::fmod(p.x, size.width) != 0 || std::fmod(p.y, size.height) != 0){
+                        tile->setTexture(assets, group.first);
+                        _unbaked += 1;
+                        continue;
+                    }
+                    tile->removeChildFrom(_view->getNode());
+                    Uint32 base = (Uint32)mesh.vertices.size();
+                    mesh.vertices.push_back(p);
+                    mesh.vertices.push_back(p + Vec2(size.width, 0));
+                    mesh.vertices.push_back(p + Vec2(size.width, size.height));
+                    mesh.vertices.push_back(p + Vec2(0, size.height));
+                    mesh.indices.push_back(base);
+                    mesh.indices.push_back(base + 1);
+                    mesh.indices.push_back(base + 2);
+                    mesh.indices.push_back(base);
+                    mesh.indices.push_back(base + 2);
+                    mesh.indices.push_back(base + 3);
+                }
+                
+                texture->setWrapS(GL_REPEAT);
+                texture->setWrapT(GL_REPEAT);
+                auto chunk = scene2::PolygonNode::allocWithTexture(texture, mesh);
+                chunk->setAnchor(Vec2::ANCHOR_BOTTOM_LEFT);
+                chunk->setPosition(origin - Vec2(size.width, size.height) / 2);
+                _view->getNode()->addChild(chunk);
+                _chunks.push_back(chunk);
+            }
+        }
+    }
+    CULog("tilemap baked: %d tiles, %d nodes before, %d after (%zu chunk meshes, %d unbaked tiles)",
+          tiles, 1 + 2 * tiles, getNodeCount(), _chunks.size(), _unbaked);
+}
+
+/** Returns how many nodes the tilemap puts into the scene graph */
+int TilemapController::getNodeCount() {
+    int count = 1;
+    if(!_chunks.empty() || _unbaked > 0){
+        return count + (int)_chunks.size() + 2 * _unbaked;
+    }
+    for(auto& tile_vec : _tilemap){
+        for(auto& tile : tile_vec){
+            if(tile != nullptr){
+                count += tile->getTextureKey() == "" ? 1 : 2;
+            }
+        }
+    }
+    return count;
+}
+
 /**
  *  Updates the model and view with the dimensions of the tilemap.
  *
@@ -246,6 +357,8 @@ void TilemapController::clearMap() {
                                           _model->color,
                                           _model->tileSize);
     scene->addChild(_view->getNode());
+    _chunks.clear();
+    _unbaked = 0;
     _tilemap.clear();
     initializeTilemap();
 }
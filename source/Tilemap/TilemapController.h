@@ -7,6 +7,16 @@
 #include <Tile/TileController.h>
 #include <ItemSet/ItemSetController.h>
 #include <memory>
+#include <map>
+#include <cmath>
+
+/** Tiles per side of a baked chunk */
+#define TILE_CHUNK_SIZE     8
+/** Comment out to give every tile its own textured node again, for comparison */
+#define TILE_CHUNK_BAKING
+/** Logs the tilemap node count, culling counts and the average render time every TILE_CHUNK_REPORT_FRAMES */
+// #define TILE_CHUNK_REPORT
+#define TILE_CHUNK_REPORT_FRAMES    600
 
 //namespace MVC {
 /**
@@ -30,6 +40,13 @@ private:
     Tilemap _tilemap;
     int _vertices; //number of vertices for adjaceny matrix
     std::unordered_map<int, Vec2> _nodes; //nodes for the matrix
+    int _edgeLength = 0; //spacing of the node grid
+    int _numPerRow = 0; //nodes per grid row
+    int _gridHeight = 0; //y of the first grid row
+    /** One node per chunk and tile texture, replacing the tile nodes */
+    std::vector<std::shared_ptr<scene2::PolygonNode>> _chunks;
+    /** Tiles that kept their own textured node */
+    int _unbaked = 0;
     
 #pragma mark Main Methods
 public:
@@ -123,6 +140,19 @@ public:
 
     void setTexture(const std::shared_ptr<cugl::AssetManager>& assets);
     std::string getTextureKey();
+    
+    /**
+     * Merges the floor tiles into one mesh per TILE_CHUNK_SIZE square chunk
+     * and tile texture. The tiles stay in the tilemap for queries, but their
+     * nodes leave the scene graph. Tiles with an atlas texture, or off the
+     * grid of their texture in the chunk, keep their own node.
+     *
+     * @param assets    The assets the tile textures come from
+     */
+    void bakeChunks(const std::shared_ptr<cugl::AssetManager>& assets);
+    
+    /** Returns how many nodes the tilemap puts into the scene graph */
+    int getNodeCount();
     /**
      * Inverts the color of the tilemap and it's tiles.
      *
@@ -368,6 +398,9 @@ public:
         
         _vertices = count;
         _nodes = nodes;
+        _edgeLength = edgeLength;
+        _numPerRow = numPerRow;
+        _gridHeight = height;
         return edges;
         
     }
@@ -380,6 +413,24 @@ public:
         return _nodes;
     }
     
+    /**
+     * Returns the grid node closest to `pos` in O(1), using the layout
+     * built by `getEdges` (rows from the top, `_numPerRow` per row).
+     *
+     * @param pos   A position in world coordinates
+     */
+    int nodeAt(Vec2 pos){
+        if (_edgeLength <= 0 || _numPerRow <= 0 || _vertices <= 0){
+            return 0;
+        }
+        int rows = (_vertices + _numPerRow - 1) / _numPerRow;
+        int col = (int)std::round(pos.x / _edgeLength);
+        int row = (int)std::round((_gridHeight - pos.y) / _edgeLength);
+        col = std::max(0, std::min(col, _numPerRow - 1));
+        row = std::max(0, std::min(row, rows - 1));
+        return std::min(row * _numPerRow + col, _vertices - 1);
+    }
+    
     
     // set priority in ordered_root
     void setPriority(float p){
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+#
+#  atlas_packer.py
+#  Tilemap
+#
+#  Packs the tile, deco, item and obstacle textures listed in
+#  Assets/json/assets.json into a few atlas pages. The result is written
+#  next to the original as Assets/json/assets_atlas.json: the same asset
+#  directory, with every packed texture replaced by an "atlas" entry of its
+#  page. CUGL names an atlas region <page>_<region>, so each page is keyed
+#  by a prefix its sprites share and the game keeps asking for the same
+#  keys (tile_past_floor_stone1, deco_past_table_side, ...).
+#
+#  Usage:   python3 tools/atlas_packer.py [--dry-run]
+#
+#  --dry-run only lays out the pages and prints the report; it reads PNG
+#  headers and does not need Pillow. Writing the pages needs Pillow.
+#
+
+import argparse
+import glob
+import json
+import os
+import struct
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'Assets')
+SOURCE = 'json/assets.json'
+OUTPUT = 'json/assets_atlas.json'
+PAGES = 'textures/atlas'
+
+# Key prefixes that are packed
+PREFIXES = ('tile', 'deco', 'artifact', 'pastB', 'presentB', 'resource', 'exit')
+# Width and height of a page, the largest size every target device loads
+PAGE_SIZE = 2048
+# Transparent pixels between sprites, the outer one is a copy of the edge
+PADDING = 2
+# Textures larger than this keep their own file
+MAX_SPRITE = 512
+
+
+def png_size(path):
+    """Returns the width and height stored in a PNG header."""
+    with open(path, 'rb') as f:
+        header = f.read(24)
+    if header[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('%s is not a PNG' % path)
+    return struct.unpack('>II', header[16:24])
+
+
+def floor_tiles():
+    """Returns the textures drawn in tilemap layers. Those are baked into
+    repeating chunk meshes at load, which an atlas region cannot do."""
+    keys = set()
+    for path in glob.glob(os.path.join(ROOT, 'tileset', 'levels', '*.json')):
+        with open(path) as f:
+            level = json.load(f)
+        for layer in level.get('layers', []):
+            if layer.get('name') == 'tilemap':
+                keys.update(o.get('type') for o in layer.get('objects', []))
+    return keys
+
+
+def packable(key, entry, floors):
+    if not key.startswith(PREFIXES) or key in floors:
+        return False
+    # sprite sheets are cut into frames by the sprite nodes
+    if key.lower().endswith('_anim') or 'sheet' in key:
+        return False
+    # anything but the default sampling needs its own texture
+    return isinstance(entry, dict) and set(entry) == {'file'}
+
+
+def shelf_pack(sprites):
+    """Places (key, w, h) sprites on shelves of one page, tallest first.
+
+    Returns the placements {key: (x, y)} and the sprites that did not fit."""
+    placed = {}
+    rest = []
+    x = y = shelf = 0
+    for key, w, h in sorted(sprites, key=lambda s: (-s[2], -s[1], s[0])):
+        pw, ph = w + 2 * PADDING, h + 2 * PADDING
+        if x + pw > PAGE_SIZE:
+            x, y, shelf = 0, y + shelf, 0
+        if y + ph > PAGE_SIZE:
+            rest.append((key, w, h))
+            continue
+        placed[key] = (x + PADDING, y + PADDING)
+        x += pw
+        shelf = max(shelf, ph)
+    return placed, rest
+
+
+def split(prefix, sprites, taken):
+    """Packs sprites that share `prefix` into pages keyed by a prefix.
+
+    A group that needs more than one page is split by the next word of its
+    keys, so every page key stays a prefix of its sprites.
+
+    Returns a list of (page key, placements, sizes) and the unpacked keys."""
+    placed, rest = shelf_pack(sprites)
+    if not rest and prefix not in taken:
+        return [(prefix, placed, {k: (w, h) for k, w, h in sprites})], []
+    groups = {}
+    loose = []
+    for key, w, h in sprites:
+        tail = key[len(prefix) + 1:]
+        if '_' not in tail:
+            # nothing left to split on
+            loose.append(key)
+            continue
+        word = tail.split('_')[0]
+        groups.setdefault(prefix + '_' + word, []).append((key, w, h))
+    pages = []
+    for sub in sorted(groups):
+        p, l = split(sub, groups[sub], taken)
+        pages += p
+        loose += l
+    return pages, loose
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pack game textures into atlas pages.')
+    parser.add_argument('--dry-run', action='store_true', help='lay out the pages without writing them')
+    args = parser.parse_args()
+
+    with open(os.path.join(ROOT, SOURCE)) as f:
+        directory = json.load(f)
+    textures = directory['textures']
+    floors = floor_tiles()
+
+    by_prefix = {}
+    for key, entry in textures.items():
+        if not packable(key, entry, floors):
+            continue
+        w, h = png_size(os.path.join(ROOT, entry['file']))
+        if w > MAX_SPRITE or h > MAX_SPRITE:
+            continue
+        prefix = key.split('_')[0]
+        by_prefix.setdefault(prefix, []).append((key, w, h))
+
+    pages = []
+    loose = []
+    for prefix in sorted(by_prefix):
+        p, l = split(prefix, by_prefix[prefix], set(textures))
+        pages += p
+        loose += l
+
+    packed = set()
+    output = dict(directory)
+    output['textures'] = {}
+    images = []
+    for page, placed, sizes in pages:
+        file = '%s/%s.png' % (PAGES, page)
+        atlas = {}
+        for key, (x, y) in sorted(placed.items()):
+            w, h = sizes[key]
+            atlas[key[len(page) + 1:]] = [x, y, x + w, y + h]
+            packed.add(key)
+        output['textures'][page] = {'file': file, 'atlas': atlas}
+        images.append((file, placed, sizes))
+    for key, entry in textures.items():
+        if key not in packed:
+            output['textures'][key] = entry
+
+    before = len(textures)
+    after = len(output['textures'])
+    print('%d textures, %d packed into %d pages, %d files after packing' % (before, len(packed), len(pages), after))
+    for page, placed, _ in pages:
+        print('  %-24s %3d sprites' % (page, len(placed)))
+    if loose:
+        print('  left unpacked: %s' % ', '.join(sorted(loose)))
+    if args.dry_run:
+        return 0
+
+    try:
+        from PIL import Image
+    except ImportError:
+        print('writing the pages needs Pillow (pip install pillow)', file=sys.stderr)
+        return 1
+    os.makedirs(os.path.join(ROOT, PAGES), exist_ok=True)
+    for file, placed, sizes in images:
+        # pages only grow as tall as their shelves, in powers of two
+        used = max(y + sizes[key][1] + PADDING for key, (x, y) in placed.items())
+        height = 1
+        while height < used:
+            height *= 2
+        sheet = Image.new('RGBA', (PAGE_SIZE, height), (0, 0, 0, 0))
+        for key, (x, y) in placed.items():
+            sprite = Image.open(os.path.join(ROOT, textures[key]['file'])).convert('RGBA')
+            # smear the edge pixels into the padding so filtering does not
+            # pull in the neighbouring sprite
+            for dx, dy in ((-1, 0), (1, 0), (0, -1), (0, 1)):
+                sheet.paste(sprite, (x + dx, y + dy))
+            sheet.paste(sprite, (x, y))
+        sheet.save(os.path.join(ROOT, file), optimize=True)
+    with open(os.path.join(ROOT, OUTPUT), 'w') as f:
+        json.dump(output, f, indent=4)
+    print('wrote %s and %d pages' % (OUTPUT, len(images)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
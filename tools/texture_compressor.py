@@ -0,0 +1,518 @@
+#!/usr/bin/env python3
+#
+#  texture_compressor.py
+#  Tilemap
+#
+#  Converts the large sprite sheets into GPU compressed textures, so mobile
+#  devices keep them compressed in memory instead of as RGBA8. Each sheet
+#  gets two KTX files in Assets/textures/compressed:
+#
+#      <name>_etc2.ktx     ETC2 RGBA8 (8 bits per pixel), core in OpenGL ES 3
+#      <name>_astc.ktx     ASTC 6x6 (3.56 bits per pixel), where supported
+#
+#  and Assets/json/compressed.json maps each PNG to its variants. The game's
+#  CompressedTextureLoader reads that file and loads the best variant the
+#  device supports, or the PNG if there is none.
+#
+#  ETC2 is encoded here. ASTC needs the astcenc encoder from ARM
+#  (https://github.com/ARM-software/astc-encoder) on the PATH and is
+#  skipped without it.
+#
+#  Usage:   python3 tools/texture_compressor.py [--verify] [textures ...]
+#
+#  A sheet whose asset entry asks for "mipmaps" gets its whole mip chain,
+#  since a compressed texture cannot build one on the GPU.
+#
+#  --verify decodes every file written back on the CPU and fails if it is
+#  too far from the PNG. Needs numpy and Pillow.
+#
+
+import argparse
+import json
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'Assets')
+OUTPUT = 'textures/compressed'
+MANIFEST = 'json/compressed.json'
+# Asset directories whose "mipmaps" flags the files follow
+DIRECTORIES = ('json/assets.json', 'json/loading.json', 'json/assets_half.json', 'json/assets_quarter.json')
+
+# The sheets worth compressing, relative to Assets
+SHEETS = (
+    'textures/spritesheet_guard_past.png',
+    'textures/spritesheet_guard_present.png',
+    'textures/enemy.png',
+    'textures/main_new.png',
+)
+
+# glInternalFormat of each variant
+GL_COMPRESSED_RGBA8_ETC2_EAC = 0x9278
+GL_COMPRESSED_RGBA_ASTC_6x6_KHR = 0x93B4
+GL_RGBA = 0x1908
+ASTC_BLOCK = (6, 6)
+
+# Lowest PSNR --verify accepts, in dB, over the pixels that are not transparent
+MIN_PSNR_COLOR = 30.0
+MIN_PSNR_ALPHA = 32.0
+# Blocks encoded per numpy pass, to bound memory
+CHUNK = 16384
+# Base colors tried around each sub-block mean, in quantization steps
+STEPS = (-1, 0, 1)
+
+KTX_IDENTIFIER = b'\xabKTX 11\xbb\r\n\x1a\n'
+
+# ETC1/ETC2 intensity modifiers, pixel index 0..3 is +a, +b, -a, -b
+ETC_TABLES = ((2, 8), (5, 17), (9, 29), (13, 42), (18, 60), (24, 80), (33, 106), (47, 183))
+# EAC alpha modifiers, index by the 3 bit pixel value
+EAC_TABLES = (
+    (-3, -6, -9, -15, 2, 5, 8, 14), (-3, -7, -10, -13, 2, 6, 9, 12),
+    (-2, -5, -8, -13, 1, 4, 7, 12), (-2, -4, -6, -13, 1, 3, 5, 12),
+    (-3, -6, -8, -12, 2, 5, 7, 11), (-3, -7, -9, -11, 2, 6, 8, 10),
+    (-4, -7, -8, -11, 3, 6, 7, 10), (-3, -5, -8, -11, 2, 4, 7, 10),
+    (-2, -6, -8, -10, 1, 5, 7, 9), (-2, -5, -8, -10, 1, 4, 7, 9),
+    (-2, -4, -8, -10, 1, 3, 7, 9), (-2, -5, -7, -10, 1, 4, 6, 9),
+    (-3, -4, -7, -10, 2, 3, 6, 9), (-1, -2, -3, -10, 0, 1, 2, 9),
+    (-4, -6, -8, -9, 3, 5, 7, 8), (-3, -5, -7, -9, 2, 4, 6, 8),
+)
+# Table 13 has a zero modifier at index 4, for blocks of a single alpha
+EAC_FLAT = 13
+
+
+#
+#  KTX containers
+#
+
+def write_ktx(path, fmt, width, height, levels):
+    """Writes a KTX 1.1 file of one image and its mip levels, largest first."""
+    header = KTX_IDENTIFIER + struct.pack('<13I', 0x04030201, 0, 1, 0, fmt, GL_RGBA,
+                                          width, height, 0, 0, 1, len(levels), 0)
+    with open(path, 'wb') as f:
+        f.write(header)
+        for data in levels:
+            f.write(struct.pack('<I', len(data)))
+            f.write(data)
+            f.write(b'\0' * (-len(data) % 4))
+
+
+def read_ktx(path):
+    """Returns the format, width, height and levels of a file from write_ktx."""
+    with open(path, 'rb') as f:
+        blob = f.read()
+    if blob[:12] != KTX_IDENTIFIER:
+        raise ValueError('%s is not a KTX file' % path)
+    fields = struct.unpack('<13I', blob[12:64])
+    levels = []
+    at = 64
+    for _ in range(fields[11]):
+        size = struct.unpack('<I', blob[at:at + 4])[0]
+        levels.append(blob[at + 4:at + 4 + size])
+        at += 4 + size + (-size % 4)
+    return fields[4], fields[6], fields[7], levels
+
+
+def mipmapped(source):
+    """Whether an asset directory asks for mipmaps on `source`."""
+    for directory in DIRECTORIES:
+        if not os.path.exists(os.path.join(ROOT, directory)):
+            # the tier directories are only there after texture_tiers.py
+            continue
+        with open(os.path.join(ROOT, directory)) as f:
+            textures = json.load(f).get('textures', {})
+        for entry in textures.values():
+            if isinstance(entry, dict) and entry.get('file') == source and entry.get('mipmaps'):
+                return True
+    return False
+
+
+def mip_chain(Image, image, mipmaps):
+    """Returns the PIL image and, if asked, its halvings down to 1x1."""
+    levels = [image]
+    while mipmaps and max(levels[-1].size) > 1:
+        w, h = levels[-1].size
+        levels.append(levels[-1].resize((max(1, w // 2), max(1, h // 2)), Image.LANCZOS))
+    return levels
+
+
+#
+#  ETC2 RGBA8: an EAC alpha block then an ETC1 compatible color block
+#
+
+def to_blocks(np, image):
+    """Cuts an HxWx4 image, padded to whole blocks, into Nx16x4 blocks.
+
+    Pixels are listed column by column, the order ETC stores them in."""
+    h, w = image.shape[:2]
+    ph, pw = -h % 4, -w % 4
+    if ph or pw:
+        image = np.pad(image, ((0, ph), (0, pw), (0, 0)), mode='edge')
+    by, bx = image.shape[0] // 4, image.shape[1] // 4
+    blocks = image.reshape(by, 4, bx, 4, 4).transpose(0, 2, 3, 1, 4)
+    return blocks.reshape(by * bx, 16, 4), (by, bx)
+
+
+def from_blocks(np, blocks, grid, width, height):
+    by, bx = grid
+    image = blocks.reshape(by, bx, 4, 4, 4).transpose(0, 3, 1, 2, 4)
+    return image.reshape(by * 4, bx * 4, 4)[:height, :width]
+
+
+def subblock_masks(np):
+    """Pixels of the first sub-block, for flip 0 (left half) and 1 (top half)."""
+    index = np.arange(16)
+    x, y = index // 4, index % 4
+    return np.stack([x < 2, y < 2])
+
+
+def encode_alpha(np, alpha):
+    """Encodes Nx16 alpha values into N EAC words."""
+    n = len(alpha)
+    alpha = alpha.astype(np.int32)
+    tables = np.array(EAC_TABLES, dtype=np.int32)
+    lo, hi = alpha.min(axis=1), alpha.max(axis=1)
+
+    # a block of one alpha, the bulk of a sprite sheet, is the base alone
+    base = lo.copy()
+    mult = np.ones(n, dtype=np.int64)
+    table = np.full(n, EAC_FLAT, dtype=np.int64)
+    pixels = np.full((n, 16), 4, dtype=np.int64)
+
+    mixed = np.nonzero(hi > lo)[0]
+    for start in range(0, len(mixed), CHUNK):
+        rows = mixed[start:start + CHUNK]
+        a = alpha[rows]
+        best = np.full(len(rows), np.iinfo(np.int64).max)
+        for t in range(16):
+            span = tables[t].max() - tables[t].min()
+            guess = np.rint((hi[rows] - lo[rows]) / span).astype(np.int32)
+            for dm in (-1, 0, 1):
+                m = np.clip(guess + dm, 1, 15)
+                b = np.clip(np.rint((lo[rows] + hi[rows]) / 2 - m * (tables[t].max() + tables[t].min()) / 2), 0, 255).astype(np.int32)
+                values = np.clip(b[:, None] + m[:, None] * tables[t][None, :], 0, 255)
+                error = (a[:, :, None] - values[:, None, :]) ** 2
+                choice = error.argmin(axis=2)
+                total = np.take_along_axis(error, choice[:, :, None], 2)[:, :, 0].sum(axis=1)
+                better = total < best
+                best = np.where(better, total, best)
+                base[rows] = np.where(better, b, base[rows])
+                mult[rows] = np.where(better, m, mult[rows])
+                table[rows] = np.where(better, t, table[rows])
+                pixels[rows] = np.where(better[:, None], choice, pixels[rows])
+
+    word = (base.astype(np.uint64) << np.uint64(56)) | (mult.astype(np.uint64) << np.uint64(52)) | (table.astype(np.uint64) << np.uint64(48))
+    for i in range(16):
+        word |= pixels[:, i].astype(np.uint64) << np.uint64(45 - 3 * i)
+    return word
+
+
+def decode_alpha(np, words):
+    tables = np.array(EAC_TABLES, dtype=np.int32)
+    base = ((words >> np.uint64(56)) & np.uint64(0xff)).astype(np.int32)
+    mult = ((words >> np.uint64(52)) & np.uint64(0xf)).astype(np.int32)
+    table = ((words >> np.uint64(48)) & np.uint64(0xf)).astype(np.int64)
+    alpha = np.empty((len(words), 16), dtype=np.int32)
+    for i in range(16):
+        index = ((words >> np.uint64(45 - 3 * i)) & np.uint64(7)).astype(np.int64)
+        alpha[:, i] = np.clip(base + mult * tables[table, index], 0, 255)
+    return alpha
+
+
+def fit_tables(np, colors, base, weight):
+    """Best ETC1 table and pixel indices of one sub-block per block.
+
+    colors are Nx16x3, base Nx3 and weight Nx16, nonzero on the visible
+    pixels of the sub-block. Returns the table, the Nx16 indices and the
+    error."""
+    n = len(colors)
+    best = np.full(n, np.iinfo(np.int64).max)
+    table = np.zeros(n, dtype=np.int64)
+    pixels = np.zeros((n, 16), dtype=np.int64)
+    for t, (a, b) in enumerate(ETC_TABLES):
+        modifiers = np.array((a, b, -a, -b), dtype=np.int32)
+        values = np.clip(base[:, None, :] + modifiers[None, :, None], 0, 255)
+        error = ((colors[:, :, None, :] - values[:, None, :, :]) ** 2).sum(axis=3)
+        choice = error.argmin(axis=2)
+        picked = np.take_along_axis(error, choice[:, :, None], 2)[:, :, 0]
+        total = (picked * weight).sum(axis=1)
+        better = total < best
+        best = np.where(better, total, best)
+        table = np.where(better, t, table)
+        pixels = np.where(better[:, None], choice, pixels)
+    return table, pixels, best
+
+
+def encode_color(np, colors, alpha):
+    """Encodes Nx16x3 colors into N ETC1 words, individual or differential.
+
+    Only the visible pixels are fitted. Blocks that are entirely transparent
+    are left black."""
+    n = len(colors)
+    words = np.zeros(n, dtype=np.uint64)
+    masks = subblock_masks(np)
+    # ETC stores pixel index (msb, lsb) as 0: +a, 1: +b, 2: -a, 3: -b
+    msb = np.array((0, 0, 1, 1), dtype=np.uint64)
+    lsb = np.array((0, 1, 0, 1), dtype=np.uint64)
+
+    visible = np.nonzero(alpha.max(axis=1) > 0)[0]
+    for start in range(0, len(visible), CHUNK):
+        rows = visible[start:start + CHUNK]
+        c = colors[rows].astype(np.int32)
+        seen = (alpha[rows] > 0).astype(np.int64)
+        # a half with nothing visible takes the color of the other
+        whole = (c * seen[:, :, None]).sum(axis=1) / seen.sum(axis=1)[:, None]
+        best = np.full(len(rows), np.iinfo(np.int64).max)
+        out = np.zeros(len(rows), dtype=np.uint64)
+        for flip in (0, 1):
+            first = masks[flip]
+            halves = (first, ~first)
+            weights = [seen * half[None, :] for half in halves]
+            means = []
+            for w in weights:
+                count = w.sum(axis=1)[:, None]
+                means.append(np.where(count > 0, (c * w[:, :, None]).sum(axis=1) / np.maximum(count, 1), whole))
+            # the rounded mean and one step either side of it, in both
+            # precisions: 4 bits a half, or 5 bits and a delta
+            q5 = [np.clip(np.rint(m * 31 / 255), 0, 31).astype(np.int32) for m in means]
+            q4 = [np.clip(np.rint(m * 15 / 255), 0, 15).astype(np.int32) for m in means]
+            every = np.arange(len(rows))
+            fit5, fit4 = [[], []], [[], []]
+            for i in (0, 1):
+                for k in STEPS:
+                    q = np.clip(q5[i] + k, 0, 31)
+                    fit5[i].append((q,) + fit_tables(np, c, (q << 3) | (q >> 2), weights[i]))
+                    q = np.clip(q4[i] + k, 0, 15)
+                    fit4[i].append((q,) + fit_tables(np, c, q * 17, weights[i]))
+
+            def pick(fits, part, choice):
+                return np.stack([f[part] for f in fits])[choice, every]
+
+            # individual mode fits each half on its own
+            sel = [np.stack([f[3] for f in fit4[i]]).argmin(axis=0) for i in (0, 1)]
+            total = pick(fit4[0], 3, sel[0]) + pick(fit4[1], 3, sel[1])
+            diff = np.zeros(len(rows), dtype=bool)
+            # differential mode needs the halves within a delta of -4..3
+            for s0 in range(len(STEPS)):
+                for s1 in range(len(STEPS)):
+                    delta = fit5[1][s1][0] - fit5[0][s0][0]
+                    error = fit5[0][s0][3] + fit5[1][s1][3]
+                    use = np.all((delta >= -4) & (delta <= 3), axis=1) & (error < total)
+                    total = np.where(use, error, total)
+                    diff |= use
+                    sel[0] = np.where(use, s0, sel[0])
+                    sel[1] = np.where(use, s1, sel[1])
+
+            chosen = []
+            for i in (0, 1):
+                q = np.where(diff[:, None], pick(fit5[i], 0, sel[i]), pick(fit4[i], 0, sel[i]))
+                table = np.where(diff, pick(fit5[i], 1, sel[i]), pick(fit4[i], 1, sel[i]))
+                pixels = np.where(diff[:, None], pick(fit5[i], 2, sel[i]), pick(fit4[i], 2, sel[i]))
+                chosen.append((q, table, pixels))
+            delta = chosen[1][0] - chosen[0][0]
+
+            word = np.zeros(len(rows), dtype=np.uint64)
+            for ch, shift in enumerate((56, 48, 40)):
+                high = np.where(diff, (chosen[0][0][:, ch] << 3) | (delta[:, ch] & 7),
+                                (chosen[0][0][:, ch] << 4) | chosen[1][0][:, ch])
+                word |= high.astype(np.uint64) << np.uint64(shift)
+            word |= chosen[0][1].astype(np.uint64) << np.uint64(37)
+            word |= chosen[1][1].astype(np.uint64) << np.uint64(34)
+            word |= diff.astype(np.uint64) << np.uint64(33)
+            word |= np.uint64(flip) << np.uint64(32)
+            for i in range(16):
+                index = np.where(first[i], chosen[0][2][:, i], chosen[1][2][:, i])
+                word |= msb[index] << np.uint64(16 + i)
+                word |= lsb[index] << np.uint64(i)
+
+            better = total < best
+            best = np.where(better, total, best)
+            out = np.where(better, word, out)
+        words[rows] = out
+    return words
+
+
+def decode_color(np, words):
+    masks = subblock_masks(np)
+    diff = ((words >> np.uint64(33)) & np.uint64(1)).astype(bool)
+    flip = ((words >> np.uint64(32)) & np.uint64(1)).astype(np.int64)
+    bases = [np.zeros((len(words), 3), dtype=np.int32) for _ in (0, 1)]
+    for ch, shift in enumerate((56, 48, 40)):
+        high = ((words >> np.uint64(shift)) & np.uint64(0xff)).astype(np.int32)
+        b5 = high >> 3
+        d = high & 7
+        d = np.where(d >= 4, d - 8, d)
+        second = b5 + d
+        bases[0][:, ch] = np.where(diff, (b5 << 3) | (b5 >> 2), (high >> 4) * 17)
+        bases[1][:, ch] = np.where(diff, (second << 3) | (second >> 2), (high & 15) * 17)
+    tables = [((words >> np.uint64(s)) & np.uint64(7)).astype(np.int64) for s in (37, 34)]
+    modifiers = np.array([(a, b, -a, -b) for a, b in ETC_TABLES], dtype=np.int32)
+    colors = np.empty((len(words), 16, 3), dtype=np.int32)
+    for i in range(16):
+        index = ((((words >> np.uint64(16 + i)) & np.uint64(1)) << np.uint64(1)) | ((words >> np.uint64(i)) & np.uint64(1))).astype(np.int64)
+        first = masks[flip, i]
+        base = np.where(first[:, None], bases[0], bases[1])
+        table = np.where(first, tables[0], tables[1])
+        colors[:, i, :] = np.clip(base + modifiers[table, index][:, None], 0, 255)
+    return colors
+
+
+def encode_etc2(np, image):
+    """Returns the ETC2 RGBA8 data of an HxWx4 uint8 image."""
+    blocks, _ = to_blocks(np, image)
+    alpha = encode_alpha(np, blocks[:, :, 3])
+    color = encode_color(np, blocks[:, :, :3], blocks[:, :, 3])
+    # each block is its alpha word then its color word, big endian
+    return np.stack([alpha, color], axis=1).astype('>u8').tobytes()
+
+
+def decode_etc2(np, data, width, height):
+    words = np.frombuffer(data, dtype='>u8').astype(np.uint64).reshape(-1, 2)
+    blocks = np.empty((len(words), 16, 4), dtype=np.int32)
+    blocks[:, :, 3] = decode_alpha(np, words[:, 0])
+    blocks[:, :, :3] = decode_color(np, words[:, 1])
+    grid = ((height + 3) // 4, (width + 3) // 4)
+    return from_blocks(np, blocks, grid, width, height).astype(np.uint8)
+
+
+#
+#  ASTC, through astcenc
+#
+
+def find_astcenc():
+    for name in ('astcenc', 'astcenc-avx2', 'astcenc-sse4.1', 'astcenc-neon', 'astcenc-native'):
+        path = shutil.which(name)
+        if path:
+            return path
+    return None
+
+
+def encode_astc(astcenc, source, work):
+    """Compresses a PNG with astcenc, returning width, height and block data."""
+    out = os.path.join(work, 'out.astc')
+    block = '%dx%d' % ASTC_BLOCK
+    subprocess.run([astcenc, '-cl', source, out, block, '-medium', '-silent'], check=True)
+    with open(out, 'rb') as f:
+        blob = f.read()
+    if struct.unpack('<I', blob[:4])[0] != 0x5CA1AB13:
+        raise ValueError('astcenc wrote an unknown header')
+    width = int.from_bytes(blob[7:10], 'little')
+    height = int.from_bytes(blob[10:13], 'little')
+    return width, height, blob[16:]
+
+
+def decode_astc(np, Image, astcenc, data, width, height, work):
+    """Decodes ASTC block data back to RGBA with astcenc."""
+    source = os.path.join(work, 'in.astc')
+    out = os.path.join(work, 'in.png')
+    header = struct.pack('<I', 0x5CA1AB13) + bytes((ASTC_BLOCK[0], ASTC_BLOCK[1], 1))
+    header += width.to_bytes(3, 'little') + height.to_bytes(3, 'little') + (1).to_bytes(3, 'little')
+    with open(source, 'wb') as f:
+        f.write(header + data)
+    subprocess.run([astcenc, '-dl', source, out, '-silent'], check=True)
+    return np.asarray(Image.open(out).convert('RGBA'))
+
+
+#
+#  Verification
+#
+
+def psnr(np, a, b, mask):
+    if not mask.any():
+        return float('inf')
+    error = ((a.astype(np.float64) - b.astype(np.float64)) ** 2)[mask].mean()
+    return float('inf') if error == 0 else 10 * np.log10(255.0 ** 2 / error)
+
+
+def compare(np, original, decoded):
+    """Returns the PSNR of the color as blended on screen, over the visible
+    pixels, and of the alpha."""
+    visible = original[:, :, 3] > 0
+    shown = [image[:, :, :3] * (image[:, :, 3:] / 255.0) for image in (original, decoded)]
+    color = psnr(np, shown[0], shown[1], np.repeat(visible[:, :, None], 3, axis=2))
+    alpha = psnr(np, original[:, :, 3], decoded[:, :, 3], np.ones(visible.shape, dtype=bool))
+    return color, alpha
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert sprite sheets to ETC2 and ASTC KTX files.')
+    parser.add_argument('--verify', action='store_true', help='decode every file written and compare it to the PNG')
+    parser.add_argument('textures', nargs='*', help='PNG files relative to Assets (default: the large sheets)')
+    args = parser.parse_args()
+
+    try:
+        import numpy as np
+        from PIL import Image
+    except ImportError:
+        print('the converter needs numpy and Pillow (pip install numpy pillow)', file=sys.stderr)
+        return 1
+
+    astcenc = find_astcenc()
+    if astcenc is None:
+        print('astcenc not found, writing ETC2 only')
+    os.makedirs(os.path.join(ROOT, OUTPUT), exist_ok=True)
+
+    manifest_path = os.path.join(ROOT, MANIFEST)
+    manifest = {}
+    if os.path.exists(manifest_path):
+        with open(manifest_path) as f:
+            manifest = json.load(f)
+
+    failed = False
+    for source in args.textures or SHEETS:
+        path = os.path.join(ROOT, source)
+        if not os.path.exists(path):
+            print('%s: missing, skipped' % source)
+            continue
+        levels = mip_chain(Image, Image.open(path).convert('RGBA'), mipmapped(source))
+        image = np.asarray(levels[0])
+        height, width = image.shape[:2]
+        name = os.path.splitext(os.path.basename(source))[0]
+        entry = {}
+
+        etc2 = [encode_etc2(np, np.asarray(level)) for level in levels]
+        entry['etc2'] = '%s/%s_etc2.ktx' % (OUTPUT, name)
+        write_ktx(os.path.join(ROOT, entry['etc2']), GL_COMPRESSED_RGBA8_ETC2_EAC, width, height, etc2)
+        variants = [('etc2', sum(len(data) for data in etc2))]
+
+        if astcenc is not None:
+            astc = []
+            with tempfile.TemporaryDirectory() as work:
+                for i, level in enumerate(levels):
+                    level_path = os.path.join(work, 'level%d.png' % i)
+                    level.save(level_path)
+                    astc.append(encode_astc(astcenc, level_path, work)[2])
+            entry['astc'] = '%s/%s_astc.ktx' % (OUTPUT, name)
+            write_ktx(os.path.join(ROOT, entry['astc']), GL_COMPRESSED_RGBA_ASTC_6x6_KHR, width, height, astc)
+            variants.append(('astc', sum(len(data) for data in astc)))
+
+        manifest[source] = entry
+        raw = width * height * 4
+        print('%s: %dx%d, %d levels, %.1f MB as RGBA8, %s' % (source, width, height, len(levels), raw / 2.0 ** 20,
+              ', '.join('%s %.1f MB' % (k, n / 2.0 ** 20) for k, n in variants)))
+
+        if args.verify:
+            for key in entry:
+                fmt, w, h, data = read_ktx(os.path.join(ROOT, entry[key]))
+                # the top level against the PNG
+                if key == 'etc2':
+                    decoded = decode_etc2(np, data[0], w, h)
+                else:
+                    with tempfile.TemporaryDirectory() as work:
+                        decoded = decode_astc(np, Image, astcenc, data[0], w, h, work)
+                color, alpha = compare(np, image, decoded)
+                ok = (w, h) == (width, height) and len(data) == len(levels)
+                ok = ok and color >= MIN_PSNR_COLOR and alpha >= MIN_PSNR_ALPHA
+                failed = failed or not ok
+                print('  %s round trip: color %.1f dB, alpha %.1f dB %s' % (key, color, alpha, 'ok' if ok else 'FAILED'))
+
+    with open(manifest_path, 'w') as f:
+        json.dump(manifest, f, indent=4, sort_keys=True)
+    print('wrote %s' % MANIFEST)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+#
+#  texture_tiers.py
+#  Tilemap
+#
+#  Writes half and quarter resolution copies of the largest textures for
+#  devices that cannot hold them at full size:
+#
+#      Assets/textures/half/...        json/assets_half.json
+#      Assets/textures/quarter/...     json/assets_quarter.json
+#
+#  Each directory is assets.json with those textures pointed at their
+#  copies. Assets/json/tiers.json lists the copied keys, whose nodes the
+#  game stretches back to full size, and the texture memory of each tier,
+#  which the game checks against its budget at startup (see TextureTier.h).
+#
+#  Only textures whose nodes call TextureTier::fit can have copies; the
+#  level textures are small and drawn at their size, and the floor tiles
+#  repeat per texel.
+#
+#  Usage:   python3 tools/texture_tiers.py [--dry-run]
+#
+#  --dry-run only prints the memory of each tier; it reads PNG headers and
+#  does not need Pillow. Writing the copies needs Pillow.
+#
+
+import argparse
+import json
+import os
+import re
+import sys
+
+from atlas_packer import ROOT, SOURCE, png_size
+
+MANIFEST = 'json/tiers.json'
+# Keys with copies; the tutorial pages and the sheets are drawn scaled down
+TIERED = ('guard_past', 'guard_present', 'character', 'spritesheet_cross_anim',
+          'question_mark_anim', 'exclamation_mark', 'shadow')
+TUTORIAL_PAGE = re.compile(r'tutorial_\d+_\d+$')
+# Name, scale and asset directory of each tier below full resolution
+TIERS = (('half', 0.5, 'json/assets_half.json'), ('quarter', 0.25, 'json/assets_quarter.json'))
+
+
+def scaled(size, scale):
+    return tuple(max(1, int(round(n * scale))) for n in size)
+
+
+def texture_bytes(size, mipmaps):
+    """RGBA8 memory of a texture, a third more with its mip levels."""
+    w, h = size
+    return w * h * 4 * (4 / 3 if mipmaps else 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Write reduced resolution copies of the level textures.')
+    parser.add_argument('--dry-run', action='store_true', help='print the memory of each tier without writing')
+    args = parser.parse_args()
+
+    with open(os.path.join(ROOT, SOURCE)) as f:
+        directory = json.load(f)
+    textures = directory['textures']
+
+    sizes = {}
+    tiered = {}
+    for key, entry in textures.items():
+        file = entry['file'] if isinstance(entry, dict) else entry
+        if not os.path.exists(os.path.join(ROOT, file)):
+            # listed but not shipped, the game never loads it either
+            continue
+        size = png_size(os.path.join(ROOT, file))
+        sizes[key] = (size, isinstance(entry, dict) and bool(entry.get('mipmaps')))
+        if key in TIERED or TUTORIAL_PAGE.match(key):
+            tiered[key] = file
+
+    manifest = {'textures': sorted(tiered), 'bytes': {}}
+    full = sum(texture_bytes(size, mips) for size, mips in sizes.values())
+    manifest['bytes']['full'] = int(full)
+    print('%d textures, %.1f MB at full resolution, %d have tier copies' % (len(textures), full / 2.0 ** 20, len(tiered)))
+    for name, scale, _ in TIERS:
+        total = sum(texture_bytes(scaled(size, scale) if key in tiered else size, mips)
+                    for key, (size, mips) in sizes.items())
+        manifest['bytes'][name] = int(total)
+        print('  %-8s %.1f MB' % (name, total / 2.0 ** 20))
+    if args.dry_run:
+        return 0
+
+    try:
+        from PIL import Image
+    except ImportError:
+        print('writing the copies needs Pillow (pip install pillow)', file=sys.stderr)
+        return 1
+    for name, scale, output in TIERS:
+        copy = dict(directory)
+        copy['textures'] = dict(textures)
+        for key, file in tiered.items():
+            target = 'textures/%s/%s' % (name, os.path.relpath(file, 'textures'))
+            os.makedirs(os.path.dirname(os.path.join(ROOT, target)), exist_ok=True)
+            image = Image.open(os.path.join(ROOT, file)).convert('RGBA')
+            image.resize(scaled(image.size, scale), Image.LANCZOS).save(os.path.join(ROOT, target), optimize=True)
+            copy['textures'][key] = dict(textures[key], file=target)
+        with open(os.path.join(ROOT, output), 'w') as f:
+            json.dump(copy, f, indent=4)
+        print('wrote %s' % output)
+    with open(os.path.join(ROOT, MANIFEST), 'w') as f:
+        json.dump(manifest, f, indent=4, sort_keys=True)
+    print('wrote %s' % MANIFEST)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())